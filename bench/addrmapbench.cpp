@@ -0,0 +1,206 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+
+// Microbenchmark of the address maps the parser looks up in
+// CFGsContainer::processCFGs(). It replays the lookups of a generated
+// CFG file, a CFG for each record and call and a node for each record
+// and edge, once with std::map and once with AddrMap, and reports the
+// lookups per second of each.
+//
+//   $ ./addrmapbench [cfgs] [rounds]
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+
+#include <AddrMap.h>
+
+struct Node {
+	Addr addr;
+};
+
+// The nodes of one CFG, like CFG::m_nodesMap.
+template <typename Map>
+struct Cfg {
+	Addr addr;
+	Map nodes;
+};
+
+// A node record: the CFG it belongs to, its address, the targets of its
+// edges and the CFGs it calls.
+struct Record {
+	Addr cfg;
+	Addr addr;
+	std::vector<Addr> succs;
+	std::vector<Addr> calls;
+};
+
+template <typename T>
+class StdMap {
+public:
+	T* find(Addr addr) const {
+		typename std::map<Addr, T*>::const_iterator it = m_map.find(addr);
+		return it != m_map.end() ? it->second : 0;
+	}
+
+	void insert(Addr addr, T* value) {
+		m_map[addr] = value;
+	}
+
+private:
+	std::map<Addr, T*> m_map;
+};
+
+template <typename T>
+class HashMap : public AddrMap<T> {
+};
+
+// Records like the ones CFGgrind writes for a large program. Nodes are
+// written in no particular order within their CFG.
+static std::vector<Record> generate(std::size_t cfgs) {
+	std::vector<Record> records;
+	records.reserve(cfgs * 16);
+
+	unsigned long seed = 1;
+	Addr cfg = 0x400000;
+	for (std::size_t i = 0; i < cfgs; i++) {
+		cfg += 0x200 + ((seed >> 52) & 0xff0);
+
+		for (int n = 0; n < 16; n++) {
+			seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+
+			Record record;
+			record.cfg = cfg;
+			record.addr = cfg + ((n * 7) % 16) * 0x20;
+			record.succs.push_back(record.addr + 0x20);
+			if (seed & 2)
+				record.succs.push_back(cfg + ((seed >> 40) % 16) * 0x20);
+			if (seed & 1)
+				record.calls.push_back(0x400000 + ((seed >> 20) % (cfgs * 0x300)));
+
+			records.push_back(record);
+		}
+	}
+
+	return records;
+}
+
+// Look up and create the CFGs and nodes of records the way the parser
+// does, and return the number of lookups. The addresses found are summed
+// into checksum.
+template <template <typename> class Map>
+static std::size_t replay(const std::vector<Record>& records, std::deque<Node>& pool,
+		uint64_t& checksum) {
+	typedef Cfg<Map<Node> > Function;
+
+	Map<Function> cfgs;
+	std::deque<Function> functions;
+	std::size_t lookups = 0;
+
+	for (const Record& record : records) {
+		Function* cfg = cfgs.find(record.cfg);
+		lookups++;
+		if (!cfg) {
+			functions.push_back(Function());
+			cfg = &functions.back();
+			cfg->addr = record.cfg;
+			cfgs.insert(record.cfg, cfg);
+		}
+
+		for (Addr addr : record.calls) {
+			Function* called = cfgs.find(addr);
+			lookups++;
+			if (!called) {
+				functions.push_back(Function());
+				called = &functions.back();
+				called->addr = addr;
+				cfgs.insert(addr, called);
+			}
+
+			checksum += called->addr;
+		}
+
+		Node* node = cfg->nodes.find(record.addr);
+		lookups++;
+		if (!node) {
+			pool.push_back(Node());
+			node = &pool.back();
+			node->addr = record.addr;
+			cfg->nodes.insert(record.addr, node);
+		}
+
+		for (Addr addr : record.succs) {
+			Node* succ = cfg->nodes.find(addr);
+			lookups++;
+			if (!succ) {
+				pool.push_back(Node());
+				succ = &pool.back();
+				succ->addr = addr;
+				cfg->nodes.insert(addr, succ);
+			}
+
+			checksum += succ->addr;
+		}
+	}
+
+	return lookups;
+}
+
+template <template <typename> class Map>
+static void run(const char* label, const std::vector<Record>& records, int rounds) {
+	std::size_t lookups = 0;
+	uint64_t checksum = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		std::deque<Node> pool;
+		lookups += replay<Map>(records, pool, checksum);
+	}
+	double secs = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+
+	std::cout << label << ": " << lookups << " lookups in " << secs << " s ("
+		<< (lookups / secs / 1e6) << " Mlookups/s, checksum " << std::hex
+		<< checksum << std::dec << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	std::size_t cfgs = argc > 1 ? std::atol(argv[1]) : 100000;
+	int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	std::vector<Record> records = generate(cfgs);
+	std::cout << "Input: " << cfgs << " CFGs, " << records.size() << " node records, "
+		<< rounds << " rounds" << std::endl;
+
+	run<StdMap>("std::map", records, rounds);
+	run<HashMap>("AddrMap ", records, rounds);
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+
+// Generate a pair of synthetic CFG files, A and B, to time the comparison
+// of many CFGs. Most CFGs are in both files, the others only in one of
+// them, and some of the shared CFGs differ in their last block.
+//
+//   $ ./gencfgs 1000000 a.cfgs b.cfgs
+//   $ time ./cmpcfgs a.cfgs b.cfgs
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+typedef unsigned long Addr;
+
+// Write the records of the CFG at addr with blocks blocks of 16 bytes,
+// each of two instructions (6 and 10 bytes), the last one falling to the exit.
+static void writeCfg(std::ostream& os, Addr addr, int blocks, unsigned long seed) {
+	os << std::hex << "[cfg 0x" << addr << ":1 \"func_" << addr << "\" false\n";
+
+	for (int i = 0; i < blocks; i++) {
+		Addr block = addr + i * 16;
+		os << std::hex << "node 0x" << addr << " 0x" << block << std::dec << " 16 [6 10] [";
+		if ((seed >> i) & 1)
+			os << std::hex << "0x" << (addr ^ 0x1000) << ":1" << std::dec;
+		os << "] [] false [";
+		if (i + 1 < blocks)
+			os << std::hex << "0x" << block + 16 << std::dec;
+		else
+			os << "exit";
+		os << "]\n";
+	}
+
+	os << "]\n";
+}
+
+int main(int argc, char* argv[]) {
+	if (argc != 4) {
+		std::cerr << "Usage: " << argv[0] << " CFGs A B" << std::endl;
+		return 1;
+	}
+
+	std::size_t cfgs = std::atol(argv[1]);
+	std::ofstream a(argv[2]), b(argv[3]);
+	if (!a.is_open() || !b.is_open()) {
+		std::cerr << "error: unable to open the output files" << std::endl;
+		return 1;
+	}
+
+	unsigned long seed = 1;
+	for (std::size_t i = 0; i < cfgs; i++) {
+		seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+
+		Addr addr = 0x400000 + i * 0x40;
+		int blocks = 1 + (seed >> 62);
+		int pick = (seed >> 32) % 100;
+
+		// 5% of the CFGs are only in A, 5% only in B and another 5% lose
+		// their last block in B.
+		if (pick >= 5)
+			writeCfg(b, addr, (pick < 15 && blocks > 1) ? blocks - 1 : blocks, seed);
+		if (pick < 5 || pick >= 10)
+			writeCfg(a, addr, blocks, seed);
+	}
+
+	return 0;
+}
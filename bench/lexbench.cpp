@@ -0,0 +1,186 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+// Microbenchmark of the lexer scanning kernels. It tokenizes a CFG file,
+// or a generated node heavy input, once with the scalar kernels and once
+// with the vector/SWAR ones, and reports the tokens per second of each.
+//
+//   $ ./lexbench [file.cfgs] [rounds]
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+
+#include <MappedFile.h>
+#include <ScanKernels.h>
+
+struct Scalar {
+	static const char* spaces(const char* p, const char* end) {
+		return skipSpacesScalar(p, end);
+	}
+
+	static const char* hex(const char* p, const char* end, uint64_t& value) {
+		return scanHexScalar(p, end, value);
+	}
+
+	static const char* decimal(const char* p, const char* end, uint64_t& value) {
+		return scanDecimalScalar(p, end, value);
+	}
+};
+
+struct Kernels {
+	static const char* spaces(const char* p, const char* end) {
+		return skipSpaces(p, end);
+	}
+
+	static const char* hex(const char* p, const char* end, uint64_t& value) {
+		return scanHex(p, end, value);
+	}
+
+	static const char* decimal(const char* p, const char* end, uint64_t& value) {
+		return scanDecimal(p, end, value);
+	}
+};
+
+// Split the input in tokens the way CFGsContainer::nextToken() does and
+// return the number of tokens. The values are summed into checksum.
+template <typename Scan>
+std::size_t tokenize(const char* p, const char* end, uint64_t& checksum) {
+	std::size_t tokens = 0;
+
+	while (p < end) {
+		// Like the lexer, only look for a run after the first space.
+		if (isSpaceChar(*p)) {
+			p = Scan::spaces(p + 1, end);
+			continue;
+		}
+
+		uint64_t value = 0;
+		if (p[0] == '0' && p + 1 < end && (p[1] | 0x20) == 'x') {
+			p = Scan::hex(p + 2, end, value);
+		} else if (*p >= '0' && *p <= '9') {
+			p = Scan::decimal(p, end, value);
+		} else if (((*p | 0x20) >= 'a' && (*p | 0x20) <= 'z')) {
+			while (p < end && ((*p | 0x20) >= 'a' && (*p | 0x20) <= 'z'))
+				p++;
+		} else if (*p == '"') {
+			while (++p < end && *p != '"')
+				;
+			p++;
+		} else {
+			p++;
+		}
+
+		checksum += value;
+		tokens++;
+	}
+
+	return tokens;
+}
+
+// Node records like the ones CFGgrind writes for a large program.
+static std::string generate(std::size_t nodes) {
+	std::ostringstream ss;
+	ss << std::hex;
+
+	unsigned long seed = 1;
+	unsigned long cfg = 0x400000;
+	for (std::size_t i = 0; i < nodes; i++) {
+		seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+
+		if (i % 16 == 0) {
+			cfg += 0x100 + (seed >> 52);
+			ss << "[cfg 0x" << cfg << " \"func" << i << "\" false]\n";
+		}
+
+		unsigned long addr = cfg + (i % 16) * 0x20;
+		int instrs = 1 + (seed >> 60);
+
+		ss << "[node 0x" << cfg << " 0x" << addr << " " << std::dec << instrs * 4 << " [";
+		for (int j = 0; j < instrs; j++)
+			ss << (j ? " " : "") << (2 + ((seed >> (j * 3)) & 7));
+		ss << "] [" << std::hex;
+		if (seed & 1)
+			ss << "0x" << cfg + 0x1000 << ":" << std::dec << (seed >> 40 & 0xff) << std::hex;
+		ss << "] [] false [0x" << addr + 0x20 << ":" << std::dec << (seed >> 32 & 0xffff)
+			<< std::hex << " exit:1]]\n";
+	}
+
+	return ss.str();
+}
+
+template <typename Scan>
+static void run(const char* label, const char* begin, const char* end, int rounds) {
+	std::size_t tokens = 0;
+	uint64_t checksum = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++)
+		tokens += tokenize<Scan>(begin, end, checksum);
+	double secs = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+
+	std::cout << label << ": " << tokens << " tokens in " << secs << " s ("
+		<< (tokens / secs / 1e6) << " Mtokens/s, checksum " << std::hex
+		<< checksum << std::dec << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	try {
+		MappedFile* file = 0;
+		std::string generated;
+		const char* begin;
+		const char* end;
+
+		if (argc > 1) {
+			file = new MappedFile(std::string(argv[1]));
+			begin = file->begin();
+			end = file->end();
+		} else {
+			generated = generate(1000000);
+			begin = generated.data();
+			end = begin + generated.size();
+		}
+
+		std::cout << "Input: " << (end - begin) / (1024.0 * 1024.0) << " MB, "
+			<< rounds << " rounds" << std::endl;
+
+		run<Scalar>("scalar ", begin, end, rounds);
+		run<Kernels>("kernels", begin, end, rounds);
+
+		if (file)
+			delete file;
+	} catch (const std::string& e) {
+		std::cerr << "error: " << e << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#ifndef _ADDRFILTER_H
+#define _ADDRFILTER_H
+
+#include <list>
+#include <vector>
+
+#include <Instruction.h>
+
+// Set of CFG addresses to load: the union of some address ranges,
+// optionally restricted to a known set of addresses. An empty filter
+// accepts every address.
+class AddrFilter {
+public:
+	AddrFilter();
+	AddrFilter(const std::list<std::pair<Addr, Addr> >& ranges);
+	virtual ~AddrFilter();
+
+	bool isEmpty() const { return m_ranges.empty() && !m_restricted; }
+	bool accepts(Addr addr) const;
+
+	// Disjoint ranges sorted by address, empty if there are none.
+	const std::vector<std::pair<Addr, Addr> >& ranges() const { return m_ranges; }
+
+	// Accept only the addresses in addrs, which must be sorted.
+	void restrictTo(const std::vector<Addr>& addrs);
+
+private:
+	std::vector<std::pair<Addr, Addr> > m_ranges;
+	bool m_restricted;
+	std::vector<Addr> m_addrs;
+
+};
+
+#endif
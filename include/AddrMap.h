@@ -0,0 +1,207 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#ifndef _ADDRMAP_H
+#define _ADDRMAP_H
+
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include <Instruction.h>
+
+// Open addressing hash map from addresses to objects, with linear probing.
+// The parser looks up a node or a CFG for every address it reads, so this
+// costs one multiplication and mostly one cache line per lookup. A null
+// value marks a free slot, so null can not be stored. Entries come in no
+// particular order; sorted() gives them by address when that matters.
+template<typename T, template<typename> class Allocator = std::allocator>
+class AddrMap {
+public:
+	struct Slot {
+		Addr addr;
+		T* value;
+
+		bool operator<(const Slot& s) const { return addr < s.addr; }
+	};
+
+	typedef std::vector<Slot, Allocator<Slot> > Slots;
+
+	class Iterator {
+	public:
+		Iterator(const Slot* slot, const Slot* last) : m_slot(slot), m_last(last) {
+			this->skip();
+		}
+
+		const Slot& operator*() const { return *m_slot; }
+		const Slot* operator->() const { return m_slot; }
+		Iterator& operator++() { m_slot++; this->skip(); return *this; }
+		Iterator operator++(int) { Iterator it = *this; ++(*this); return it; }
+		bool operator==(const Iterator& it) const { return m_slot == it.m_slot; }
+		bool operator!=(const Iterator& it) const { return m_slot != it.m_slot; }
+
+	private:
+		const Slot* m_slot;
+		const Slot* m_last;
+
+		void skip() {
+			while (m_slot != m_last && !m_slot->value)
+				m_slot++;
+		}
+	};
+
+	AddrMap(const Allocator<Slot>& allocator = Allocator<Slot>()) :
+		m_slots(allocator), m_size(0), m_shift(64) {}
+
+	Allocator<Slot> get_allocator() const { return m_slots.get_allocator(); }
+
+	std::size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	Iterator begin() const { return Iterator(m_slots.data(), m_slots.data() + m_slots.size()); }
+	Iterator end() const {
+		const Slot* last = m_slots.data() + m_slots.size();
+		return Iterator(last, last);
+	}
+
+	T* find(Addr addr) const {
+		if (m_size == 0)
+			return 0;
+
+		for (std::size_t i = this->home(addr); ; i = this->next(i)) {
+			const Slot& slot = m_slots[i];
+			if (!slot.value)
+				return 0;
+			if (slot.addr == addr)
+				return slot.value;
+		}
+	}
+
+	// Add addr or replace what it was mapped to.
+	void insert(Addr addr, T* value) {
+		assert(value != 0);
+
+		// At most three quarters of the slots are used.
+		if (4 * (m_size + 1) > 3 * m_slots.size())
+			this->rehash(m_slots.empty() ? 4 : 2 * m_slots.size());
+
+		for (std::size_t i = this->home(addr); ; i = this->next(i)) {
+			Slot& slot = m_slots[i];
+			if (!slot.value) {
+				slot.addr = addr;
+				slot.value = value;
+				m_size++;
+				return;
+			}
+
+			if (slot.addr == addr) {
+				slot.value = value;
+				return;
+			}
+		}
+	}
+
+	// Shift the entries that follow back, so no tombstones are left.
+	bool erase(Addr addr) {
+		if (m_size == 0)
+			return false;
+
+		std::size_t i = this->home(addr);
+		for (; m_slots[i].addr != addr || !m_slots[i].value; i = this->next(i)) {
+			if (!m_slots[i].value)
+				return false;
+		}
+
+		for (std::size_t j = this->next(i); m_slots[j].value; j = this->next(j)) {
+			// An entry may fill the hole unless its home lies
+			// cyclically in (i, j].
+			std::size_t k = this->home(m_slots[j].addr);
+			if ((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+				m_slots[i] = m_slots[j];
+				i = j;
+			}
+		}
+
+		m_slots[i].value = 0;
+		m_size--;
+		return true;
+	}
+
+	// Forget every entry, the slots are kept.
+	void clear() {
+		for (Slot& slot : m_slots)
+			slot.value = 0;
+		m_size = 0;
+	}
+
+	// The entries in address order.
+	std::vector<Slot> sorted() const {
+		std::vector<Slot> entries;
+		entries.reserve(m_size);
+		for (Iterator it = this->begin(), ed = this->end(); it != ed; it++)
+			entries.push_back(*it);
+
+		std::sort(entries.begin(), entries.end());
+		return entries;
+	}
+
+private:
+	Slots m_slots;
+	std::size_t m_size;
+	unsigned m_shift;
+
+	// Fibonacci hashing spreads the aligned, clustered code addresses
+	// over the top bits of the product.
+	std::size_t home(Addr addr) const {
+		return (uint64_t) (addr * UINT64_C(0x9E3779B97F4A7C15)) >> m_shift;
+	}
+
+	std::size_t next(std::size_t i) const { return (i + 1) & (m_slots.size() - 1); }
+
+	// The old slots are left to the allocator, which may be an arena.
+	void rehash(std::size_t capacity) {
+		Slots old(m_slots.get_allocator());
+		old.swap(m_slots);
+
+		Slot empty = { 0, 0 };
+		m_slots.assign(capacity, empty);
+		m_size = 0;
+
+		m_shift = 64;
+		for (std::size_t n = capacity; n > 1; n >>= 1)
+			m_shift--;
+
+		for (const Slot& slot : old) {
+			if (slot.value)
+				this->insert(slot.addr, slot.value);
+		}
+	}
+
+};
+
+#endif
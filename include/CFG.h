@@ -26,9 +26,15 @@
 #define _CFG_H
 
 #include <map>
+#include <cassert>
 #include <string>
 
+#include <AddrMap.h>
 #include <CfgNode.h>
+#include <CfgGraph.h>
+#include <StringArena.h>
+
+class CFGsContainer;
 
 class CFG {
 public:
@@ -38,11 +44,14 @@ public:
 		VALID
 	};
 
-	CFG(Addr addr);
+	// The CFG, its nodes and everything they refer to live in arena.
+	CFG(Addr addr, CfgArena& arena);
 	virtual ~CFG();
 
 	Addr addr() const { return m_addr; }
-	const std::string& functionName() const { return m_functionName; }
+	std::string functionName() const {
+		return std::string(m_functionName, StringArena::length(m_functionName));
+	}
 	enum Status status() const { return m_status; }
 
 	CfgNode* entryNode() const { return m_entryNode; }
@@ -51,26 +60,43 @@ public:
 	CfgNode* nodeByAddr(Addr addr) const;
 	std::list<CfgNode*> nodes() const;
 
+	// The frozen layout of a VALID CFG, built by check().
+	const CfgGraph& graph() const {
+		assert(m_status == CFG::VALID && m_graph != 0);
+		return *m_graph;
+	}
+
 	bool containsNode(CfgNode* node);
 	void addEdge(CfgNode* from, CfgNode* to);
 
 	void setFunctionName(const std::string& functionName);
+	void setFunctionName(const char* functionName, std::size_t length);
 	void addNode(CfgNode* node);
+	void merge(CFG* other);
 
 	void compress();
 	enum CFG::Status check();
 
-	std::string toDOT() const;
-	void dumpDOT(const std::string& fileName);
+	// The names of called CFGs are looked up in container.
+	std::string toDOT(const CFGsContainer& container) const;
+	void dumpDOT(const std::string& fileName, const CFGsContainer& container);
 
 private:
+	typedef AddrMap<CfgNode, CfgArena::Allocator> NodesMap;
+
 	Addr m_addr;
 	enum Status m_status;
-	std::string m_functionName;
+	const char* m_functionName;
 	CfgNode* m_entryNode;
 	CfgNode* m_exitNode;
 	CfgNode* m_haltNode;
-	std::map<Addr, CfgNode*> m_nodesMap;
+	CFG::NodesMap m_nodesMap;
+	CfgGraph* m_graph;
+
+	CfgArena& arena() const { return *m_nodesMap.get_allocator().arena(); }
+	void setUnchecked();
+
+	friend class CfgGraph;
 
 };
 
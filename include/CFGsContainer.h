@@ -27,24 +27,65 @@
 
 #include <map>
 #include <set>
+#include <list>
+#include <vector>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <cstddef>
+#include <ctime>
 
 #include <CFG.h>
+#include <AddrMap.h>
+#include <CfgsIndex.h>
+#include <AddrFilter.h>
+
+class MappedFile;
+class Decompressor;
 
 class CFGsContainer {
 public:
-	CFGsContainer(const std::string& filename, const std::string& name = "");
+	struct Options {
+		int jobs;
+		bool cache;
+		bool index;
+
+		// Do not load anything up front, read one CFG at a time with next().
+		bool stream;
+
+		// Keep the input open, update() parses what is appended to it.
+		bool follow;
+
+		// Load only the CFGs accepted by this filter. Calls refer to CFGs
+		// by address, loaded or not.
+		AddrFilter filter;
+
+		Options(int jobs = 1, bool cache = false, bool index = false,
+				bool stream = false, bool follow = false,
+				const AddrFilter& filter = AddrFilter()) :
+			jobs(jobs), cache(cache), index(index), stream(stream), follow(follow),
+			filter(filter) {}
+		virtual ~Options() {}
+	};
+
+	CFGsContainer(const std::string& filename, const std::string& name = "",
+			const CFGsContainer::Options& options = CFGsContainer::Options());
 	virtual ~CFGsContainer();
 
 	CFG* cfg(Addr addr) const;
 	std::set<CFG*> cfgs() const;
+	std::vector<CFG*> sortedCfgs() const;
+
+	CFG* next();
+	bool update(std::set<Addr>& changed);
 
 	void compressAll();
 	void checkAll();
 	void dumpAll(const char* directory);
 
+	void saveSnapshot(const std::string& filename) const;
+
+	std::size_t inputSize() const { return m_inputSize; }
+	double loadTime() const { return m_loadTime; }
+
 private:
 	struct Lexeme {
 		enum Type {
@@ -66,7 +107,11 @@ private:
 		};
 
 		enum Type type;
-		std::string token;
+
+		// The token text points straight into the input buffer and
+		// is only valid until the next token is read.
+		const char* text;
+		std::size_t length;
 
 		union {
 			Addr addr;
@@ -74,17 +119,78 @@ private:
 			bool boolean;
 		} data;
 
-		Lexeme() : type(TKN_EOF), token("") {}
+		Lexeme() : type(TKN_EOF), text(0), length(0) {}
+
+		std::string token() const { return std::string(text, length); }
 	};
 
-	std::fstream m_input;
+	MappedFile* m_file;
+	Decompressor* m_reader;
+	std::vector<char> m_window;
+	const char* m_cursor;
+	const char* m_limit;
+	const char* m_refillAt;
+
+	// Input from here on is kept by refill() along with the unread input,
+	// while a token is peeked, see recordOwner().
+	const char* m_mark;
+	const AddrFilter* m_filter;
+	AddrFilter m_streamFilter;
+	Addr m_streamOwner;
+	const char* m_streamDiscarded;
+	int m_followFd;
+	std::size_t m_followOffset;
+	std::size_t m_followPending;
+	std::set<Addr>* m_changed;
+	int m_pipeFd;
 	std::string m_name;
+	std::string m_filename;
+	CfgArena* m_arena;
+	std::vector<CfgArena*> m_adopted;
 	Lexeme m_currentToken;
-	std::map<Addr, CFG*> m_cfgsMap;
-
+	AddrMap<CFG> m_cfgsMap;
+	std::size_t m_inputSize;
+	std::size_t m_sourceSize;
+	struct timespec m_sourceMtime;
+	double m_loadTime;
+
+	CFGsContainer(const char* begin, const char* end, const AddrFilter* filter);
+
+	static bool isPipe(const std::string& filename);
+	void closePipe();
+
+	void setInput(const char* begin, const char* end);
+	std::size_t readInput(char* buffer, std::size_t size);
+	bool refill();
+	int nextChar();
+	void putbackChar(int c);
 	Lexeme nextToken();
 	void matchToken(enum Lexeme::Type type);
 	void processCFGs();
+	void processRecord();
+	bool skipRecord();
+	Addr recordOwner();
+
+	CFG* cfgOrNew(Addr addr);
+	CfgNode* addBlock(CFG* cfg, Addr addr);
+	CfgNode* nodeOrPhantom(CFG* cfg, Addr addr);
+	CfgNode* exitNode(CFG* cfg);
+	CfgNode* haltNode(CFG* cfg);
+
+	static const struct SnapshotHeader* validSnapshot(const MappedFile& file);
+	void loadSnapshot(const MappedFile& file);
+	bool loadCache(const std::string& filename);
+
+	CfgsIndex* openIndex(const std::string& filename);
+	void scanRecords(CfgsIndex::RecordsMap& records);
+	bool loadIndexed(const std::string& filename, const AddrFilter& filter);
+
+	void parse(const char* begin, const char* end);
+	void parseCompressed();
+	void parseParallel(int jobs);
+	void merge(CFGsContainer* other);
+	void dropAll();
+	void destroyAll();
 
 };
 
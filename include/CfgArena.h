@@ -0,0 +1,95 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#ifndef _CFGARENA_H
+#define _CFGARENA_H
+
+#include <new>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+// Monotonic storage for everything a container builds: CFGs, their nodes,
+// node data, adjacency sets and instruction lists. Memory
+// is carved out of large blocks, so the objects of a function sit next to
+// each other, and is never given back on its own. Objects in the arena are
+// not destroyed one by one; the whole arena is released at once.
+class CfgArena {
+public:
+	// Standard allocator drawing from an arena, for the containers kept
+	// inside arena objects. Deallocation does nothing.
+	template<typename T>
+	class Allocator {
+	public:
+		typedef T value_type;
+
+		Allocator(CfgArena& arena) : m_arena(&arena) {}
+		template<typename U>
+		Allocator(const Allocator<U>& other) : m_arena(other.arena()) {}
+
+		T* allocate(std::size_t n) {
+			return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+		}
+		void deallocate(T*, std::size_t) {}
+
+		CfgArena* arena() const { return m_arena; }
+
+		template<typename U>
+		bool operator==(const Allocator<U>& other) const { return m_arena == other.arena(); }
+		template<typename U>
+		bool operator!=(const Allocator<U>& other) const { return m_arena != other.arena(); }
+
+	private:
+		CfgArena* m_arena;
+	};
+
+	CfgArena();
+	virtual ~CfgArena();
+
+	void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+
+	template<typename T, typename... Args>
+	T* create(Args&&... args) {
+		return new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	// Drop everything allocated so far. The current block is kept for
+	// what comes next.
+	void reset();
+
+	std::size_t size() const { return m_size; }
+
+private:
+	std::vector<char*> m_blocks;
+	char* m_block;
+	std::size_t m_used;
+	std::size_t m_size;
+
+	CfgArena(const CfgArena&);
+	CfgArena& operator=(const CfgArena&);
+
+};
+
+#endif
@@ -25,19 +25,31 @@
 #ifndef _CFGDATA_H
 #define _CFGDATA_H
 
-#include <set>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
 #include <Instruction.h>
+#include <RelAddr.h>
 
 class CFG;
 
+// What the strategies compare of a checked CFG. Every category is a sorted
+// vector without repetitions, so two CFGs are matched by merging them.
+// Items are kept as offsets from the address of the CFG when all of their
+// addresses are near it, see RelAddr, and whole otherwise. Two CFGs at the
+// same address split their items the same way, so each part is matched on
+// its own.
 class CfgData {
 public:
 	struct Node {
+		typedef Addr Position;
+
 		Addr start;
 		int size;
 
 		Node(Addr start, int size) : start(start), size(size) {}
-		virtual ~Node() {}
+
+		Position end() const { return start + size; }
 
 	    bool operator<(const Node& n) const {
 	    		if (start == n.start)
@@ -51,13 +63,34 @@ public:
 	    }
 	};
 
+	struct NearNode {
+		typedef int64_t Position;
+
+		RelAddr::Offset start;
+		int32_t size;
+
+		NearNode(RelAddr::Offset start, int32_t size) : start(start), size(size) {}
+
+		Position end() const { return (Position) start + size; }
+
+	    bool operator<(const NearNode& n) const {
+	    		if (start == n.start)
+	    			return size < n.size;
+	    		else
+	    			return start < n.start;
+	    }
+
+	    bool operator==(const NearNode& n) const {
+	        return start == n.start && size == n.size;
+	    }
+	};
+
 	// if from is zero the edge is from the entry node,
 	// if the to is zero the edge is to the exit node.
 	struct Edge {
 		Addr from, to;
 		Edge(Addr from, Addr to)
 			: from(from), to(to) {}
-		virtual ~Edge() {}
 
 	    bool operator<(const Edge& e) const {
 	    		if (from == e.from)
@@ -71,41 +104,117 @@ public:
 	    }
 	};
 
+	struct NearEdge {
+		RelAddr::Offset from, to;
+		NearEdge(RelAddr::Offset from, RelAddr::Offset to)
+			: from(from), to(to) {}
+
+	    bool operator<(const NearEdge& e) const {
+	    		if (from == e.from)
+	    			return to < e.to;
+	    		else
+	    			return from < e.from;
+	    }
+
+	    bool operator==(const NearEdge& e) const {
+	        return from == e.from && to == e.to;
+	    }
+	};
+
+	// One call of a block, a block calling n CFGs has n of them.
 	struct Call {
 		Addr block_addr;
-		std::set<Addr> calls;
+		Addr target;
 
-		Call(Addr block_addr) : block_addr(block_addr) {}
-		virtual ~Call() {}
+		Call(Addr block_addr, Addr target) : block_addr(block_addr), target(target) {}
 
 	    bool operator<(const Call& c) const {
-			return block_addr < c.block_addr;
+	    		if (block_addr == c.block_addr)
+	    			return target < c.target;
+	    		else
+	    			return block_addr < c.block_addr;
 	    }
 
 	    bool operator==(const Call& c) const {
-	        return block_addr == c.block_addr;
+	        return block_addr == c.block_addr && target == c.target;
 	    }
 	};
 
+	struct NearCall {
+		RelAddr::Offset block_addr;
+		RelAddr::Offset target;
+
+		NearCall(RelAddr::Offset block_addr, RelAddr::Offset target)
+			: block_addr(block_addr), target(target) {}
+
+	    bool operator<(const NearCall& c) const {
+	    		if (block_addr == c.block_addr)
+	    			return target < c.target;
+	    		else
+	    			return block_addr < c.block_addr;
+	    }
+
+	    bool operator==(const NearCall& c) const {
+	        return block_addr == c.block_addr && target == c.target;
+	    }
+	};
+
+	// A category split in its near and far items.
+	template<typename Near, typename Far>
+	struct Items {
+		std::vector<Near> near;
+		std::vector<Far> far;
+
+		std::size_t size() const { return near.size() + far.size(); }
+	};
+
+	typedef Items<RelAddr::Offset, Addr> Addrs;
+	typedef Items<CfgData::NearNode, CfgData::Node> Nodes;
+	typedef Items<CfgData::NearEdge, CfgData::Edge> Edges;
+	typedef Items<CfgData::NearCall, CfgData::Call> Calls;
+
 	CfgData(CFG* cfg);
 	virtual ~CfgData();
 
-	const std::set<Addr>& instrs() const { return m_instrs; }
-	const std::set<CfgData::Node>& blocks() const { return m_blocks; }
-	const std::set<Addr>& phantoms() const { return m_phantoms; }
-	const std::set<CfgData::Edge> edges() const { return m_edges; }
-	const std::set<CfgData::Call> calls() const { return m_calls; }
-	const std::set<Addr>& indirects() const { return m_indirects; }
+	Addr base() const { return m_base; }
+
+	const CfgData::Addrs& instrs() const { return m_instrs; }
+	const CfgData::Nodes& blocks() const { return m_blocks; }
+	const CfgData::Addrs& phantoms() const { return m_phantoms; }
+	const CfgData::Edges& edges() const { return m_edges; }
+	const CfgData::Calls& calls() const { return m_calls; }
+	const CfgData::Addrs& indirects() const { return m_indirects; }
+
+	// Add an item to the near or the far part of a category.
+	static void add(CfgData::Addrs& items, Addr base, Addr addr);
+	static void add(CfgData::Nodes& items, Addr base, const CfgData::Node& node);
+	static void add(CfgData::Edges& items, Addr base, const CfgData::Edge& edge);
+	static void add(CfgData::Calls& items, Addr base, const CfgData::Call& call);
+
+	template<typename T>
+	static void sortUnique(std::vector<T>& items) {
+		std::sort(items.begin(), items.end());
+		items.erase(std::unique(items.begin(), items.end()), items.end());
+	}
+
+	template<typename Near, typename Far>
+	static void sortUnique(Items<Near, Far>& items) {
+		CfgData::sortUnique(items.near);
+		CfgData::sortUnique(items.far);
+	}
 
 private:
-	std::set<Addr> m_instrs;
-	std::set<CfgData::Node> m_blocks;
-	std::set<Addr> m_phantoms;
-	std::set<CfgData::Edge> m_edges;
-	std::set<CfgData::Call> m_calls;
-	std::set<Addr> m_indirects;
+	Addr m_base;
+	CfgData::Addrs m_instrs;
+	CfgData::Nodes m_blocks;
+	CfgData::Addrs m_phantoms;
+	CfgData::Edges m_edges;
+	CfgData::Calls m_calls;
+	CfgData::Addrs m_indirects;
+
+	CfgData(const CfgData&);
+	CfgData& operator=(const CfgData&);
 
 };
 
 #endif
-
@@ -0,0 +1,124 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#ifndef _CFGGRAPH_H
+#define _CFGGRAPH_H
+
+#include <vector>
+#include <cstdint>
+
+#include <CfgNode.h>
+
+class CFG;
+
+// Read-only compressed sparse row layout of a checked CFG. The entry node
+// is numbered 0, the blocks and phantoms follow in address order and the
+// exit and halt nodes come last. Adjacency lists and block attributes are
+// kept in arrays indexed by node, so walks scan memory sequentially.
+class CfgGraph {
+public:
+	typedef uint32_t Index;
+
+	static const Index NONE = (Index) -1;
+
+	template<typename T>
+	class Range {
+	public:
+		Range(const T* first, const T* last) : m_first(first), m_last(last) {}
+
+		const T* begin() const { return m_first; }
+		const T* end() const { return m_last; }
+		std::size_t size() const { return m_last - m_first; }
+		bool empty() const { return m_first == m_last; }
+
+	private:
+		const T* m_first;
+		const T* m_last;
+	};
+
+	CfgGraph(const CFG* cfg);
+	virtual ~CfgGraph();
+
+	Index size() const { return m_types.size(); }
+	Index entry() const { return 0; }
+	Index exit() const { return m_exit; }
+	Index halt() const { return m_halt; }
+
+	enum CfgNode::Type type(Index node) const { return (enum CfgNode::Type) m_types[node]; }
+
+	// Zero for the entry, exit and halt nodes, like CfgNode::addr().
+	Addr addr(Index node) const { return m_addrs[node]; }
+
+	// Attributes of blocks, zero for the other nodes.
+	int blockSize(Index node) const { return m_sizes[node]; }
+	bool isIndirect(Index node) const { return m_indirects[node] != 0; }
+	InstrRun instructions(Index node) const {
+		Range<uint8_t> sizes = slice<uint8_t>(m_instrSizes, m_instrOffsets, node);
+		return InstrRun(m_addrs[node], sizes.begin(), sizes.end());
+	}
+	Range<Addr> calls(Index node) const { return slice<Addr>(m_calls, m_callOffsets, node); }
+
+	Range<Index> successors(Index node) const { return slice<Index>(m_succs, m_succOffsets, node); }
+	Range<Index> predecessors(Index node) const { return slice<Index>(m_preds, m_predOffsets, node); }
+
+	// Totals over every node, to size what is built from the graph.
+	std::size_t countInstructions() const { return m_instrCount; }
+	std::size_t countCalls() const { return m_calls.size(); }
+	std::size_t countEdges() const { return m_succs.size(); }
+
+private:
+	// Kept on the heap rather than in the arena of the CFG, so that the
+	// layout of a CFG checked again is given back.
+	template<typename T>
+	struct Array {
+		typedef std::vector<T> Type;
+	};
+
+	Index m_exit;
+	Index m_halt;
+	std::size_t m_instrCount;
+	Array<uint8_t>::Type m_types;
+	Array<Addr>::Type m_addrs;
+	Array<int>::Type m_sizes;
+	Array<uint8_t>::Type m_indirects;
+	Array<Index>::Type m_instrOffsets;
+	Array<uint8_t>::Type m_instrSizes;
+	Array<Index>::Type m_callOffsets;
+	Array<Addr>::Type m_calls;
+	Array<Index>::Type m_succOffsets;
+	Array<Index>::Type m_succs;
+	Array<Index>::Type m_predOffsets;
+	Array<Index>::Type m_preds;
+
+	template<typename T>
+	static Range<T> slice(const typename Array<T>::Type& items,
+			const Array<Index>::Type& offsets, Index node) {
+		const T* base = items.data();
+		return Range<T>(base + offsets[node], base + offsets[node + 1]);
+	}
+
+};
+
+#endif
@@ -25,9 +25,14 @@
 #ifndef _CFGNODE_H
 #define _CFGNODE_H
 
+#include <map>
 #include <set>
 #include <list>
+#include <cassert>
 #include <Instruction.h>
+#include <CfgArena.h>
+#include <SmallVector.h>
+#include <InstrRun.h>
 
 class CFG;
 
@@ -41,110 +46,101 @@ public:
 		CFG_HALT
 	};
 
-	class Data {
+	// The attributes of a block, kept inline in its node. Calls and signal
+	// handlers are deduplicated in insertion order. They refer to the
+	// called CFGs by address, which need not have records of their own.
+	class BlockData {
 	public:
-		virtual ~Data() {}
+		struct SignalHandler {
+			int sigid;
+			Addr addr;
+		};
 
-		Addr addr() const { return m_addr; }
-
-	protected:
-		Addr m_addr;
-
-		Data(Addr addr) : m_addr(addr) {}
-	};
-
-	class PhantomData : public Data {
-	public:
-		PhantomData(Addr addr) : Data(addr) {}
-		virtual ~PhantomData() {};
-	};
+		typedef SmallVector<Addr, 1> Calls;
+		typedef SmallVector<SignalHandler, 1> SignalHandlers;
 
-	class BlockData : public Data {
-	public:
-		BlockData(Addr addr) : Data(addr), m_size(0), m_indirection(false) {}
-		virtual ~BlockData() {};
+		BlockData(CfgArena& arena, Addr addr) : m_arena(&arena), m_addr(addr), m_size(0),
+			m_indirection(false), m_instrCount(0) {}
 
+		Addr addr() const { return m_addr; }
 		int size() const { return m_size; }
 
 		bool isIndirect() const { return m_indirection; }
 		void setIndirect(bool indirect = true);
 
-		const std::list<Instruction*>& instructions() const { return m_instrs; }
-		void addInstruction(Instruction* instr);
-		void addInstructions(const std::list<Instruction*>& instrs);
-		Instruction* firstInstruction() const;
-		Instruction* lastInstruction() const;
+		InstrRun instructions() const {
+			return InstrRun(m_addr, m_instrSizes.begin(), m_instrSizes.end());
+		}
+		std::size_t countInstructions() const { return m_instrCount; }
+		void addInstruction(int size);
+		void addInstructions(const BlockData* next);
 		void clearInstructions();
 
-		const std::set<CFG*>& calls() const { return m_calls; }
-		void addCall(CFG* cfg);
+		const Calls& calls() const { return m_calls; }
+		void addCall(Addr addr);
 		void clearCalls();
 
-		const std::map<int, CFG*> signalHandlers() const { return m_signalHandlers; }
-		void addSignalHandler(int sigid, CFG* cfg);
+		const SignalHandlers& signalHandlers() const { return m_signalHandlers; }
+		void addSignalHandler(int sigid, Addr addr);
 		void clearSignalHandlers();
 
 	private:
+		CfgArena* m_arena;
+		Addr m_addr;
 		int m_size;
 		bool m_indirection;
-		std::list<Instruction*> m_instrs;
-		std::set<CFG*> m_calls;
-		std::map<int, CFG*> m_signalHandlers;
+		uint32_t m_instrCount;
+		SmallVector<uint8_t, 8> m_instrSizes;
+		Calls m_calls;
+		SignalHandlers m_signalHandlers;
 
-	};
-
-	struct Edge {
-		CfgNode* node;
-
-		Edge(CfgNode* node) : node(node) {}
-		Edge(const Edge& e) : node(e.node) {}
-		virtual ~Edge() {}
+		friend class CfgNode;
 
-		Edge& operator=(const Edge& e) {
-			node = e.node;
-			return *this;
-		}
-
-		bool operator<(const Edge& e) const {
-			return node < e.node;
-		}
-
-		bool operator==(const Edge& e) const {
-			return node == e.node;
-		}
 	};
 
-	CfgNode(enum CfgNode::Type type);
-	virtual ~CfgNode();
+	// Adjacent nodes in insertion order. Most blocks have one or two.
+	typedef SmallVector<CfgNode*, 2> Edges;
 
-	enum CfgNode::Type type() const { return m_type; }
-	Data* data() const { return m_data; }
-	const std::set<CfgNode::Edge>& successors() const { return m_succs; }
-	const std::set<CfgNode::Edge>& predecessors() const { return m_preds; }
+	// Blocks and phantoms have an address, the other nodes have zero.
+	CfgNode(CfgArena& arena, enum CfgNode::Type type, Addr addr = 0);
+	~CfgNode();
 
-	void setData(Data* data);
+	enum CfgNode::Type type() const { return m_type; }
+	Addr addr() const { return m_block.m_addr; }
+	const CfgNode::Edges& successors() const { return m_succs; }
+	const CfgNode::Edges& predecessors() const { return m_preds; }
+
+	BlockData* block() {
+		assert(m_type == CfgNode::CFG_BLOCK);
+		return &m_block;
+	}
+	const BlockData* block() const {
+		assert(m_type == CfgNode::CFG_BLOCK);
+		return &m_block;
+	}
+
+	// Turn a phantom into the block its record describes.
+	void makeBlock();
 
 	int countSuccessors() const { return m_succs.size(); }
 	bool hasSuccessors() const { return m_succs.size() > 0; }
 	bool addSuccessor(CfgNode* succ);
-	void addSuccessors(const std::set<CfgNode::Edge>& succs);
+	void addSuccessors(const CfgNode::Edges& succs);
 	bool removeSuccessor(CfgNode* succ);
 	void clearSuccessors();
 
 	int countPredecessor() const { return m_preds.size(); }
 	bool hasPredecessor() const { return m_preds.size() > 0; }
 	bool addPredecessor(CfgNode* pred);
-	void addPredecessors(const std::set<CfgNode::Edge>& preds);
+	void addPredecessors(const CfgNode::Edges& preds);
 	bool removePredecessor(CfgNode* pred);
 	void clearPredecessors();
 
-	static Addr node2addr(CfgNode* node);
-
 private:
 	enum CfgNode::Type m_type;
-	Data* m_data;
-	std::set<CfgNode::Edge> m_succs;
-	std::set<CfgNode::Edge> m_preds;
+	CfgNode::Edges m_succs;
+	CfgNode::Edges m_preds;
+	BlockData m_block;
 
 };
 
@@ -0,0 +1,101 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#ifndef _CFGSINDEX_H
+#define _CFGSINDEX_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <ctime>
+
+#include <Instruction.h>
+
+class MappedFile;
+class AddrFilter;
+
+// Sidecar index (file.cfgi) of a CFG file, mapping each CFG address
+// to the byte ranges of its cfg and node records.
+//
+// File layout, in host byte order:
+//
+//   Header
+//   Cfg   cfgs[header.cfgs]      (sorted by address)
+//   Range ranges[header.ranges]  (each cfg's ranges sorted by offset)
+class CfgsIndex {
+public:
+	struct Range {
+		uint64_t offset;
+		uint64_t length;
+
+		Range(uint64_t offset = 0, uint64_t length = 0)
+			: offset(offset), length(length) {}
+
+		bool operator<(const Range& r) const {
+			return offset < r.offset;
+		}
+	};
+
+	typedef std::map<Addr, std::vector<CfgsIndex::Range> > RecordsMap;
+
+	CfgsIndex(const std::string& filename);
+	virtual ~CfgsIndex();
+
+	bool isUpToDate(std::size_t sourceSize, const struct timespec& sourceMtime) const;
+
+	std::vector<CfgsIndex::Range> select(const AddrFilter& filter) const;
+	std::vector<Addr> addresses() const;
+
+	static CfgsIndex* open(const std::string& sourceFilename);
+
+	static std::string indexName(const std::string& filename);
+	static void write(const std::string& filename, const CfgsIndex::RecordsMap& records,
+			std::size_t sourceSize, const struct timespec& sourceMtime);
+
+private:
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceMtimeSec;
+		int64_t sourceMtimeNsec;
+		uint64_t cfgs;
+		uint64_t ranges;
+	};
+
+	struct Cfg {
+		uint64_t addr;
+		uint64_t first;
+		uint64_t count;
+	};
+
+	MappedFile* m_file;
+	const Header* m_header;
+	const Cfg* m_cfgs;
+	const Range* m_ranges;
+
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#ifndef _DECOMPRESSOR_H
+#define _DECOMPRESSOR_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+class MappedFile;
+
+// Decompress a gzip, zstd or xz file on a background thread. The
+// decompressed data is handed over through a ring of fixed size blocks,
+// so decompression overlaps with whoever reads it.
+class Decompressor {
+public:
+	enum Format {
+		NONE,
+		GZIP,
+		ZSTD,
+		XZ
+	};
+
+	Decompressor(const MappedFile& file);
+	virtual ~Decompressor();
+
+	// Copy up to size decompressed bytes to buffer, at most one block at
+	// a time. Return 0 at the end.
+	std::size_t read(char* buffer, std::size_t size);
+	bool getline(std::string& line);
+
+	static enum Format format(const char* data, std::size_t size);
+	static enum Format format(const MappedFile& file);
+
+private:
+	struct Block {
+		std::vector<char> data;
+		std::size_t size;
+	};
+
+	const MappedFile& m_file;
+	enum Format m_format;
+
+	std::vector<Block> m_blocks;
+	std::size_t m_head;
+	std::size_t m_count;
+	bool m_done;
+	bool m_stop;
+	std::string m_error;
+	std::mutex m_lock;
+	std::condition_variable m_filled;
+	std::condition_variable m_drained;
+
+	// The block being read and the read position in it.
+	std::size_t m_offset;
+	bool m_reading;
+
+	std::thread m_worker;
+
+	void run();
+	void decompressGzip();
+	void decompressZstd();
+	void decompressXz();
+
+	Block* emptyBlock();
+	void pushBlock();
+	Block* currentBlock();
+	void popBlock();
+
+	Decompressor(const Decompressor&);
+	Decompressor& operator=(const Decompressor&);
+
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#ifndef _INSTRRUN_H
+#define _INSTRRUN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <Instruction.h>
+
+// The instructions of a block, which follow each other in memory: the
+// address of the first one and their sizes, packed one byte each. Sizes
+// that do not fit in a byte are stored as a zero byte and four more bytes.
+// Instruction objects, which hold the assembly text, are looked up only
+// when the text is needed.
+class InstrRun {
+public:
+	struct Entry {
+		Addr addr;
+		int size;
+	};
+
+	class Iterator {
+	public:
+		Iterator(Addr addr, const uint8_t* pos) : m_addr(addr), m_pos(pos) {}
+
+		Entry operator*() const {
+			Entry entry;
+			entry.addr = m_addr;
+			entry.size = InstrRun::decode(m_pos, 0);
+			return entry;
+		}
+
+		Iterator& operator++() {
+			m_addr += InstrRun::decode(m_pos, &m_pos);
+			return *this;
+		}
+
+		bool operator==(const Iterator& other) const { return m_pos == other.m_pos; }
+		bool operator!=(const Iterator& other) const { return m_pos != other.m_pos; }
+
+	private:
+		Addr m_addr;
+		const uint8_t* m_pos;
+	};
+
+	// Bytes needed by the largest encoded size.
+	static const std::size_t MAX_ENCODED = 5;
+
+	InstrRun(Addr start, const uint8_t* first, const uint8_t* last) :
+		m_start(start), m_first(first), m_last(last) {}
+
+	Addr start() const { return m_start; }
+	bool empty() const { return m_first == m_last; }
+
+	// The packed sizes, to append a run to another block.
+	const uint8_t* encoded() const { return m_first; }
+	std::size_t encodedLength() const { return m_last - m_first; }
+
+	Iterator begin() const { return Iterator(m_start, m_first); }
+	Iterator end() const { return Iterator(0, m_last); }
+
+	// Store size at out and return the number of bytes used.
+	static std::size_t encode(int size, uint8_t* out) {
+		if (size > 0 && size <= 0xff) {
+			out[0] = size;
+			return 1;
+		}
+
+		uint32_t large = size;
+		out[0] = 0;
+		std::memcpy(out + 1, &large, sizeof(large));
+		return 1 + sizeof(large);
+	}
+
+	// Read the size at pos and, if next is given, point it past the size.
+	static int decode(const uint8_t* pos, const uint8_t** next) {
+		if (pos[0] != 0) {
+			if (next)
+				*next = pos + 1;
+
+			return pos[0];
+		}
+
+		uint32_t large;
+		std::memcpy(&large, pos + 1, sizeof(large));
+		if (next)
+			*next = pos + 1 + sizeof(large);
+
+		return large;
+	}
+
+private:
+	Addr m_start;
+	const uint8_t* m_first;
+	const uint8_t* m_last;
+
+};
+
+#endif
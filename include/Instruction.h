@@ -25,31 +25,72 @@
 #ifndef _INSTRUCTION_H
 #define _INSTRUCTION_H
 
-#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
+#include <cstddef>
 
 typedef unsigned long Addr;
 
+class MappedFile;
+
 class Instruction {
 public:
 	virtual ~Instruction();
 
 	Addr addr() const { return m_addr; }
 	int size() const { return m_size; }
-	const std::string& text() const { return m_text; }
+	std::string text() const;
 
 	static Instruction* get(Addr addr, int size = 0);
-	static void load(std::string filename);
+	static Instruction* find(Addr addr);
+	static void load(const std::string& filename, int jobs = 1);
 	static void clear();
 
 private:
+	struct Entry {
+		Addr addr;
+		int size;
+		std::size_t textOffset;
+		unsigned textLength;
+	};
+
+	// Instructions are kept in shards selected by address, each with its
+	// own lock, open addressing table and slabs the instructions are
+	// allocated from.
+	struct Shard {
+		std::mutex lock;
+		std::vector<Instruction*> table;
+		std::size_t used;
+		std::vector<Instruction*> slabs;
+		std::size_t slabUsed;
+
+		Shard() : used(0), slabUsed(0) {}
+	};
+
 	Addr m_addr;
+
+	// The assembly text stays in the instructions map and is only decoded
+	// by text(), from its offset in m_mapText.
+	std::size_t m_textOffset;
+
 	int m_size;
-	std::string m_text;
+	unsigned m_textLength;
+
+	static Shard m_shards[];
+
+	static MappedFile* m_mapFile;
+	static std::vector<char> m_mapBuffer;
+	static const char* m_mapText;
+
+	Instruction(Addr addr, int size);
 
-	static std::map<Addr, Instruction*> m_instrsMap;
+	static Instruction* getLocked(Shard& shard, Addr addr, int size);
+	static void rehash(Shard& shard, std::size_t capacity);
 
-	Instruction(Addr addr, int size, const std::string& text = "???");
+	static void parseEntries(const char* base, const char* begin, const char* end,
+			std::vector<Instruction::Entry>& entries);
+	static void loadChunk(const char* base, const char* begin, const char* end);
 
 };
 
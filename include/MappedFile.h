@@ -0,0 +1,62 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+#include <ctime>
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+	MappedFile(const std::string& filename);
+	virtual ~MappedFile();
+
+	const std::string& filename() const { return m_filename; }
+	const char* data() const { return m_data; }
+	std::size_t size() const { return m_size; }
+	const struct timespec& mtime() const { return m_mtime; }
+
+	const char* begin() const { return m_data; }
+	const char* end() const { return m_data + m_size; }
+
+	// Hint the kernel about how the mapping will be read.
+	void adviseSequential() const;
+	void adviseRandom() const;
+	void discard(const char* end) const;
+
+private:
+	std::string m_filename;
+	char* m_data;
+	std::size_t m_size;
+	struct timespec m_mtime;
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+};
+
+#endif
@@ -0,0 +1,61 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#ifndef _RELADDR_H
+#define _RELADDR_H
+
+#include <cassert>
+#include <cstdint>
+
+#include <Instruction.h>
+
+// Addresses of a CFG as 32-bit offsets from the address of its function.
+// Blocks, phantoms and instructions almost always lie within a few MB of
+// it, so offsets take half the space of full addresses. The address zero
+// of the entry and exit nodes has an offset of its own. Addresses further
+// than 2 GB away are far and must be kept whole.
+class RelAddr {
+public:
+	typedef int32_t Offset;
+
+	static const Offset NONE = INT32_MIN;
+
+	static bool isNear(Addr base, Addr addr) {
+		int64_t offset = (int64_t) (addr - base);
+		return addr == 0 || (offset > INT32_MIN && offset <= INT32_MAX);
+	}
+
+	static Offset encode(Addr base, Addr addr) {
+		assert(RelAddr::isNear(base, addr));
+		return addr == 0 ? RelAddr::NONE : (Offset) (addr - base);
+	}
+
+	static Addr decode(Addr base, Offset offset) {
+		return offset == RelAddr::NONE ? 0 : base + (int64_t) offset;
+	}
+
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#ifndef _REORDERBUFFER_H
+#define _REORDERBUFFER_H
+
+#include <map>
+#include <mutex>
+#include <cstddef>
+#include <functional>
+
+// Hand values that are put in any order to write in the order of their
+// indexes, starting at 0. Whoever puts the next expected value writes it,
+// along with the ones after it that were already waiting.
+template<typename T>
+class ReorderBuffer {
+public:
+	typedef std::function<void(std::size_t index, const T& value)> Writer;
+
+	ReorderBuffer(const Writer& writer) : m_writer(writer), m_next(0) {}
+	virtual ~ReorderBuffer() {}
+
+	void put(std::size_t index, const T& value) {
+		std::lock_guard<std::mutex> guard(m_lock);
+		if (index != m_next) {
+			m_pending.insert(std::make_pair(index, value));
+			return;
+		}
+
+		m_writer(m_next++, value);
+
+		typename std::map<std::size_t, T>::iterator it;
+		while ((it = m_pending.begin()) != m_pending.end() && it->first == m_next) {
+			m_writer(m_next++, it->second);
+			m_pending.erase(it);
+		}
+	}
+
+private:
+	Writer m_writer;
+	std::size_t m_next;
+	std::map<std::size_t, T> m_pending;
+	std::mutex m_lock;
+
+	ReorderBuffer(const ReorderBuffer&);
+	ReorderBuffer& operator=(const ReorderBuffer&);
+
+};
+
+#endif
@@ -0,0 +1,273 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#ifndef _SCANKERNELS_H
+#define _SCANKERNELS_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Scanning kernels for the tokens that make up most of a CFG file:
+// whitespace, hex addresses and decimal sizes. Each kernel reads from p
+// up to end and returns where the scanned run stops. The vector and SWAR
+// paths read whole blocks, so they only run while enough input is left
+// and the scalar versions finish the rest.
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SCAN_SWAR 1
+#endif
+
+#define SCAN_ONES  0x0101010101010101ULL
+#define SCAN_HIGHS 0x8080808080808080ULL
+
+inline bool isSpaceChar(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline int hexDigitValue(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+
+	c |= 0x20;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+
+	return -1;
+}
+
+inline const char* skipSpacesScalar(const char* p, const char* end) {
+	while (p < end && isSpaceChar(*p))
+		p++;
+
+	return p;
+}
+
+inline const char* scanHexScalar(const char* p, const char* end, uint64_t& value) {
+	int d;
+	while (p < end && (d = hexDigitValue(*p)) >= 0) {
+		value = (value << 4) | d;
+		p++;
+	}
+
+	return p;
+}
+
+inline const char* scanDecimalScalar(const char* p, const char* end, uint64_t& value) {
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = (value * 10) + (*p - '0');
+		p++;
+	}
+
+	return p;
+}
+
+#ifdef SCAN_SWAR
+
+inline uint64_t loadBlock8(const char* p) {
+	uint64_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+// Bytes of v within [lo, hi] get their high bit set, for ASCII bytes.
+inline uint64_t swarInRange(uint64_t v, unsigned char lo, unsigned char hi) {
+	uint64_t ge = v + SCAN_ONES * (0x80 - lo);
+	uint64_t gt = v + SCAN_ONES * (0x80 - hi - 1);
+	return ge & ~gt & SCAN_HIGHS;
+}
+
+// Number of leading hex digits in the 8 bytes at p.
+inline int swarHexDigits(uint64_t v) {
+	uint64_t ascii = v & ~SCAN_HIGHS;
+	uint64_t digits = swarInRange(ascii, '0', '9') |
+			swarInRange(ascii | (SCAN_ONES * 0x20), 'a', 'f');
+	uint64_t invalid = (~digits | v) & SCAN_HIGHS;
+
+	return invalid ? __builtin_ctzll(invalid) >> 3 : 8;
+}
+
+// Number of leading decimal digits in the 8 bytes at p.
+inline int swarDecimalDigits(uint64_t v) {
+	uint64_t digits = swarInRange(v & ~SCAN_HIGHS, '0', '9');
+	uint64_t invalid = (~digits | v) & SCAN_HIGHS;
+
+	return invalid ? __builtin_ctzll(invalid) >> 3 : 8;
+}
+
+// Value of the first n (1 to 8) hex digits in v.
+inline uint64_t swarHexValue(uint64_t v, int n) {
+	// '0'-'9' keep their low nibble, 'a'-'f' and 'A'-'F' add 9 to it.
+	uint64_t nibbles = (v & (SCAN_ONES * 0x0f)) + ((v >> 6) & SCAN_ONES) * 9;
+
+	// Drop the bytes after the digits, the missing digits become zeros.
+	nibbles <<= 8 * (8 - n);
+
+	// The first digit is the lowest byte: merge pairs, then quads, then halves.
+	nibbles = ((nibbles & 0x0f000f000f000f00ULL) >> 8) | ((nibbles & 0x000f000f000f000fULL) << 4);
+	nibbles = ((nibbles & 0x00ff000000ff0000ULL) >> 16) | ((nibbles & 0x000000ff000000ffULL) << 8);
+	nibbles = ((nibbles & 0x0000ffff00000000ULL) >> 32) | ((nibbles & 0x000000000000ffffULL) << 16);
+
+	return nibbles;
+}
+
+// Value of the first n (1 to 8) decimal digits in v.
+inline uint64_t swarDecimalValue(uint64_t v, int n) {
+	v = (v - SCAN_ONES * '0') << (8 * (8 - n));
+
+	v = (v * 10) + (v >> 8);
+	v = (((v & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32))) +
+		(((v >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32)))) >> 32;
+
+	return v;
+}
+
+// Number of leading hex digits in the 16 bytes at p.
+inline int hexDigits16(const char* p) {
+#if defined(__SSE2__)
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+
+	// Bytes above 0x7f compare as negative and are never digits.
+	__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+			_mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+	__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+			_mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+
+	unsigned mask = _mm_movemask_epi8(_mm_or_si128(digit, alpha));
+	return __builtin_ctz(~mask | 0x10000);
+#else
+	int n = swarHexDigits(loadBlock8(p));
+	return n < 8 ? n : 8 + swarHexDigits(loadBlock8(p + 8));
+#endif
+}
+
+inline const char* skipSpaces(const char* p, const char* end) {
+	// Most runs are a single space, do not bother with blocks for them.
+	if (p < end && !isSpaceChar(*p))
+		return p;
+
+#if defined(__AVX2__)
+	while (end - p >= 32) {
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i spaces = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+
+		unsigned mask = ~(unsigned) _mm256_movemask_epi8(spaces);
+		if (mask)
+			return p + __builtin_ctz(mask);
+
+		p += 32;
+	}
+#elif defined(__SSE2__)
+	while (end - p >= 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i spaces = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+				_mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+				_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+
+		unsigned mask = ~(unsigned) _mm_movemask_epi8(spaces) & 0xffff;
+		if (mask)
+			return p + __builtin_ctz(mask);
+
+		p += 16;
+	}
+#endif
+
+	return skipSpacesScalar(p, end);
+}
+
+// Scan the hex digits at p and shift them into value.
+inline const char* scanHex(const char* p, const char* end, uint64_t& value) {
+	while (end - p >= 16) {
+		int n = hexDigits16(p);
+		if (n == 0)
+			return p;
+
+		int first = n < 8 ? n : 8;
+		uint64_t chunk = swarHexValue(loadBlock8(p), first);
+		if (n > 8)
+			chunk = (chunk << (4 * (n - 8))) | swarHexValue(loadBlock8(p + 8), n - 8);
+
+		// Digits beyond the 16th push the first ones out, as in the scalar loop.
+		value = (n < 16 ? value << (4 * n) : 0) | chunk;
+		p += n;
+
+		if (n < 16)
+			return p;
+	}
+
+	return scanHexScalar(p, end, value);
+}
+
+// Scan the decimal digits at p and add them to value.
+inline const char* scanDecimal(const char* p, const char* end, uint64_t& value) {
+	static const uint64_t powers[] = {
+		1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+	};
+
+	while (end - p >= 8) {
+		uint64_t v = loadBlock8(p);
+		int n = swarDecimalDigits(v);
+		if (n == 0)
+			return p;
+
+		value = (value * powers[n]) + swarDecimalValue(v, n);
+		p += n;
+
+		if (n < 8)
+			return p;
+	}
+
+	return scanDecimalScalar(p, end, value);
+}
+
+#else
+
+inline const char* skipSpaces(const char* p, const char* end) {
+	return skipSpacesScalar(p, end);
+}
+
+inline const char* scanHex(const char* p, const char* end, uint64_t& value) {
+	return scanHexScalar(p, end, value);
+}
+
+inline const char* scanDecimal(const char* p, const char* end, uint64_t& value) {
+	return scanDecimalScalar(p, end, value);
+}
+
+#endif
+
+#endif
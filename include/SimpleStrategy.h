@@ -26,6 +26,8 @@
 #define _SIMPLESTRATEGY_H
 
 #include <set>
+#include <map>
+#include <vector>
 #include <Strategy.h>
 
 class SimpleStrategy : public Strategy {
@@ -42,9 +44,21 @@ public:
 		Stats() : cfgs(0), instrs(0), blocks(0), phantoms(0), edges(0), calls(0), indirects(0) {}
 		Stats(const Stats& stats) : cfgs(stats.cfgs), instrs(stats.instrs), blocks(stats.blocks),
 				phantoms(stats.phantoms), edges(stats.edges), calls(stats.calls),
-				indirects(0) {}
+				indirects(stats.indirects) {}
 		virtual ~Stats() {}
 
+		Stats& operator=(const Stats& stats) {
+			cfgs = stats.cfgs;
+			instrs = stats.instrs;
+			blocks = stats.blocks;
+			phantoms = stats.phantoms;
+			edges = stats.edges;
+			calls = stats.calls;
+			indirects = stats.indirects;
+
+			return *this;
+		}
+
 		Stats& operator+=(const Stats& stats) {
 			cfgs += stats.cfgs;
 			instrs += stats.instrs;
@@ -56,6 +70,18 @@ public:
 
 			return *this;
 		}
+
+		Stats& operator-=(const Stats& stats) {
+			cfgs -= stats.cfgs;
+			instrs -= stats.instrs;
+			blocks -= stats.blocks;
+			phantoms -= stats.phantoms;
+			edges -= stats.edges;
+			calls -= stats.calls;
+			indirects -= stats.indirects;
+
+			return *this;
+		}
 	};
 
 	struct Report {
@@ -66,6 +92,22 @@ public:
 
 		Report() {}
 		virtual ~Report() {}
+
+		Report& operator+=(const Report& report) {
+			matched += report.matched;
+			unmatched.a += report.unmatched.a;
+			unmatched.b += report.unmatched.b;
+
+			return *this;
+		}
+
+		Report& operator-=(const Report& report) {
+			matched -= report.matched;
+			unmatched.a -= report.unmatched.a;
+			unmatched.b -= report.unmatched.b;
+
+			return *this;
+		}
 	};
 
 	SimpleStrategy(const StrategyConfig& config);
@@ -73,13 +115,26 @@ public:
 
 	void process();
 
+protected:
+	void processPair(CFG* a, CFG* b);
+	void processParallel(const std::vector<Strategy::Pair>& pairs);
+	void retractPair(Addr addr);
+	void printTotals();
+
 private:
-	template<typename T> std::set<T> matchGeneric(std::set<T>& a, std::set<T>& b);
+	Report m_total;
+
+	// With --follow, the part of the totals each address added.
+	std::map<Addr, Report> m_followed;
+
+	template<typename T> int matchGeneric(const std::vector<T>& a, const std::vector<T>& b);
+	template<typename Near, typename Far> int matchGeneric(const CfgData::Items<Near, Far>& a,
+			const CfgData::Items<Near, Far>& b);
 
-	std::set<CfgData::Call> matchCalls(std::set<CfgData::Call>& a, std::set<CfgData::Call>& b);
-	int countCalls(const std::set<CfgData::Call>& calls);
 	Stats extractStats(CFG* cfg);
 	Report compareCFGs(CFG* a, CFG* b);
+	Report comparePair(CFG* a, CFG* b);
+	void writePair(CFG* a, CFG* b, const Report& r);
 
 };
 
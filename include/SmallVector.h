@@ -0,0 +1,120 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#ifndef _SMALLVECTOR_H
+#define _SMALLVECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#include <CfgArena.h>
+
+// Vector of trivially copyable items that keeps up to N of them inline and
+// moves to an arena once it grows past that. Meant for the many short lists
+// of a CFG, such as the successors of a node, which mostly hold one or two
+// items. The arena is given on each insertion, so it costs no space here.
+template<typename T, unsigned N>
+class SmallVector {
+public:
+	static_assert(std::is_trivially_copyable<T>::value,
+		"SmallVector items are copied as plain memory");
+
+	SmallVector() : m_size(0), m_capacity(N) {}
+
+	const T* begin() const { return this->items(); }
+	const T* end() const { return this->items() + m_size; }
+	std::size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	const T& front() const { return this->items()[0]; }
+	const T& operator[](std::size_t index) const { return this->items()[index]; }
+
+	bool contains(const T& item) const {
+		return std::find(this->begin(), this->end(), item) != this->end();
+	}
+
+	void push_back(const T& item, CfgArena& arena) {
+		if (m_size == m_capacity)
+			this->grow(m_size + 1, arena);
+
+		this->items()[m_size++] = item;
+	}
+
+	void append(const T* first, const T* last, CfgArena& arena) {
+		std::size_t count = last - first;
+		if (m_size + count > m_capacity)
+			this->grow(m_size + count, arena);
+
+		std::copy(first, last, this->items() + m_size);
+		m_size += count;
+	}
+
+	// Remove the first occurrence of item, keeping the order of the others.
+	bool erase(const T& item) {
+		T* first = this->items();
+		T* last = first + m_size;
+		T* pos = std::find(first, last, item);
+		if (pos == last)
+			return false;
+
+		std::copy(pos + 1, last, pos);
+		m_size--;
+		return true;
+	}
+
+	// The storage is kept for the items added next.
+	void clear() { m_size = 0; }
+
+private:
+	uint32_t m_size;
+	uint32_t m_capacity;
+	union {
+		T m_inline[N];
+		T* m_outside;
+	};
+
+	SmallVector(const SmallVector&);
+	SmallVector& operator=(const SmallVector&);
+
+	T* items() { return m_capacity > N ? m_outside : m_inline; }
+	const T* items() const { return m_capacity > N ? m_outside : m_inline; }
+
+	// The old storage is left to the arena.
+	void grow(std::size_t needed, CfgArena& arena) {
+		uint32_t capacity = 2 * m_capacity;
+		while (capacity < needed)
+			capacity *= 2;
+
+		T* outside = static_cast<T*>(arena.allocate(capacity * sizeof(T), alignof(T)));
+		std::copy(this->begin(), this->end(), outside);
+
+		m_outside = outside;
+		m_capacity = capacity;
+	}
+
+};
+
+#endif
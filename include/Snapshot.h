@@ -0,0 +1,93 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <cstdint>
+
+// Layout of a binary CFG snapshot (.cfgb) file, in host byte order:
+//
+//   SnapshotHeader
+//   SnapshotCfg    cfgs[header.cfgs]
+//   SnapshotNode   nodes[header.nodes]
+//   SnapshotSignal signals[header.signals]
+//   uint64_t       calls[header.calls]
+//   uint64_t       succs[header.succs]
+//   uint8_t        sizes[header.sizes]
+//   char           names[header.names]
+//
+// The nodes of each cfg follow the nodes of the previous one, and each node
+// consumes its instruction sizes, calls, signal handlers and successors from
+// the respective arrays in the same way. Only blocks are stored: phantoms and
+// entry edges are recreated from the successor lists, and CFGs that are only
+// the target of calls or signal handlers are recreated from those.
+
+#define SNAPSHOT_MAGIC    "CFGB"
+#define SNAPSHOT_VERSION  1
+
+#define SNAPSHOT_SUCC_EXIT  (~(uint64_t) 0)
+#define SNAPSHOT_SUCC_HALT  (~(uint64_t) 1)
+
+struct SnapshotHeader {
+	char magic[4];
+	uint32_t version;
+
+	// Size and modification time of the text file this snapshot was made of.
+	uint64_t sourceSize;
+	int64_t sourceMtimeSec;
+	int64_t sourceMtimeNsec;
+
+	uint64_t cfgs;
+	uint64_t nodes;
+	uint64_t signals;
+	uint64_t calls;
+	uint64_t succs;
+	uint64_t sizes;
+	uint64_t names;
+};
+
+struct SnapshotCfg {
+	uint64_t addr;
+	uint64_t name;
+	uint32_t nameLength;
+	uint32_t nodes;
+};
+
+struct SnapshotNode {
+	uint64_t addr;
+	uint32_t instrs;
+	uint32_t calls;
+	uint32_t signals;
+	uint32_t succs;
+	uint32_t indirect;
+	uint32_t reserved;
+};
+
+struct SnapshotSignal {
+	int64_t sigid;
+	uint64_t addr;
+};
+
+#endif
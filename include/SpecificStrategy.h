@@ -26,6 +26,8 @@
 #define _SPECIFICSTRATEGY_H
 
 #include <set>
+#include <map>
+#include <vector>
 #include <Strategy.h>
 
 class SpecificStrategy : public Strategy {
@@ -55,6 +57,17 @@ public:
 				calls(stats.calls), indirects(stats.indirects) {}
 		virtual ~Stats() {}
 
+		Stats& operator=(const Stats& stats) {
+			instrs = stats.instrs;
+			blocks = stats.blocks;
+			phantoms = stats.phantoms;
+			edges = stats.edges;
+			calls = stats.calls;
+			indirects = stats.indirects;
+
+			return *this;
+		}
+
 		Stats& operator+=(const Stats& stats) {
 			instrs += stats.instrs;
 			blocks.perfect += stats.blocks.perfect;
@@ -69,6 +82,21 @@ public:
 
 			return *this;
 		}
+
+		Stats& operator-=(const Stats& stats) {
+			instrs -= stats.instrs;
+			blocks.perfect -= stats.blocks.perfect;
+			blocks.conflict -= stats.blocks.conflict;
+			phantoms -= stats.phantoms;
+			edges.internal.perfect -= stats.edges.internal.perfect;
+			edges.internal.conflict -= stats.edges.internal.conflict;
+			edges.external.perfect -= stats.edges.external.perfect;
+			edges.external.conflict -= stats.edges.external.conflict;
+			calls -= stats.calls;
+			indirects -= stats.indirects;
+
+			return *this;
+		}
 	};
 
 	SpecificStrategy(const StrategyConfig& config);
@@ -76,37 +104,66 @@ public:
 
 	void process();
 
+protected:
+	void processPair(CFG* aCFG, CFG* bCFG);
+	void processParallel(const std::vector<Strategy::Pair>& pairs);
+	void retractPair(Addr addr);
+	void printTotals();
+
 private:
+	// The data of a CFG, plus the edges between the consecutive
+	// instructions of its blocks.
 	struct Info {
-		std::set<Addr> instrs;
-		struct Block {
-			std::set<CfgData::Node> perfect, conflict;
-		} blocks;
-		std::set<Addr> phantoms;
-		struct Edge {
-			struct {
-				std::set<CfgData::Edge> perfect, conflict;
-			} internal, external;
-		} edges;
-		std::set<CfgData::Call> calls;
-		std::set<Addr> indirects;
+		CfgData data;
+		CfgData::Edges internal;
+
+		Info(CFG* cfg) : data(cfg) {}
 	};
 
 	struct Report {
-		SpecificStrategy::Info present, missing;
+		int cfgs;
+		SpecificStrategy::Stats present, missing;
+
+		Report() : cfgs(0) {}
+
+		Report& operator+=(const Report& report) {
+			cfgs += report.cfgs;
+			present += report.present;
+			missing += report.missing;
+
+			return *this;
+		}
+
+		Report& operator-=(const Report& report) {
+			cfgs -= report.cfgs;
+			present -= report.present;
+			missing -= report.missing;
+
+			return *this;
+		}
 	};
 
-	void matchAddresses(std::set<Addr>& aInstrs, std::set<Addr>& bInstrs);
-	void matchBlocks(SpecificStrategy::Info::Block& aBlocks,
-			SpecificStrategy::Info::Block& bBlocks);
-	void matchEdges(SpecificStrategy::Info::Edge& aEdges,
-			SpecificStrategy::Info::Edge& bEdges);
-	void matchCalls(std::set<CfgData::Call>& aCalls,
-			std::set<CfgData::Call>& bCalls);
+	template<typename T> int matchGeneric(const std::vector<T>& a, const std::vector<T>& b);
+	template<typename Near, typename Far> int matchGeneric(const CfgData::Items<Near, Far>& a,
+			const CfgData::Items<Near, Far>& b);
+	template<typename T> void matchBlocks(const std::vector<T>& aBlocks,
+			const std::vector<T>& bBlocks, SpecificStrategy::Report& report);
+	void matchBlocks(Addr base, const CfgData::Nodes& aBlocks, const CfgData::Nodes& bBlocks,
+			SpecificStrategy::Report& report);
+	template<typename T> void matchEdges(const std::vector<T>& aInternal,
+			const std::vector<T>& aExternal, const std::vector<T>& bInternal,
+			const std::vector<T>& bExternal, SpecificStrategy::Report& report);
+	void matchEdges(const SpecificStrategy::Info& a, const SpecificStrategy::Info& b,
+			SpecificStrategy::Report& report);
 	SpecificStrategy::Report compareCFGs(CFG* a, CFG* b);
+	void writePair(CFG* aCFG, CFG* bCFG, const SpecificStrategy::Report& report);
+
+	void extractInfo(CFG* cfg, SpecificStrategy::Info& info);
+
+	SpecificStrategy::Report m_total;
 
-	SpecificStrategy::Info extractInfo(CFG* cfg);
-	SpecificStrategy::Stats extractStats(const SpecificStrategy::Info& info);
+	// With --follow, the part of the totals each address added.
+	std::map<Addr, SpecificStrategy::Report> m_followed;
 
 };
 
@@ -27,8 +27,12 @@
 
 #include <fstream>
 #include <list>
+#include <vector>
+#include <cstddef>
 #include <CfgData.h>
+#include <AddrFilter.h>
 
+class CFG;
 class CFGsContainer;
 
 struct StrategyConfig {
@@ -42,19 +46,33 @@ struct StrategyConfig {
 	char* dump;
 	char* input1;
 	char* input2;
+	bool verbose;
+	int jobs;
+	bool cache;
+	bool index;
+	bool stream;
+	bool follow;
+	int interval;
 
 	StrategyConfig(bool compress = false, bool detailed = false,
 			bool specific = false, bool both = false,
 			std::list<std::pair<Addr, Addr> > ranges = std::list<std::pair<Addr, Addr> >(),
 			char* instrs = 0, char* output = 0,
-			char* dump = 0, char* input1 = 0, char* input2 = 0) :
+			char* dump = 0, char* input1 = 0, char* input2 = 0,
+			bool verbose = false, int jobs = 1, bool cache = false,
+			bool index = false, bool stream = false, bool follow = false,
+			int interval = 10) :
 		compress(compress), detailed(detailed), specific(specific), both(both), ranges(ranges),
-		instrs(instrs), output(output), dump(dump), input1(input1), input2(input2) {}
+		instrs(instrs), output(output), dump(dump), input1(input1), input2(input2),
+		verbose(verbose), jobs(jobs), cache(cache), index(index), stream(stream),
+		follow(follow), interval(interval) {}
 	StrategyConfig(const StrategyConfig& config) :
 		compress(config.compress), detailed(config.detailed),
 		specific(config.specific), both(config.both), ranges(config.ranges),
 		instrs(config.instrs), output(config.output), dump(config.dump),
-		input1(config.input1), input2(config.input2) {}
+		input1(config.input1), input2(config.input2), verbose(config.verbose),
+		jobs(config.jobs), cache(config.cache), index(config.index),
+		stream(config.stream), follow(config.follow), interval(config.interval) {}
 	virtual ~StrategyConfig() {}
 };
 
@@ -67,13 +85,44 @@ public:
 	bool isAddrInRange(Addr addr) const;
 
 protected:
+	// The CFGs of A and B to compare at one address, as in processPair().
+	struct Pair {
+		CFG* a;
+		CFG* b;
+
+		Pair(CFG* a, CFG* b) : a(a), b(b) {}
+	};
+
 	StrategyConfig m_config;
+	AddrFilter m_filter;
 	CFGsContainer* m_a;
 	CFGsContainer* m_b;
 	std::ofstream m_fout;
 
 	Strategy(const StrategyConfig& config);
 
+	// Compare the CFGs with the same address in A and B. One of them is 0
+	// when the other is the only valid CFG with that address in range.
+	virtual void processPair(CFG* a, CFG* b) = 0;
+
+	// Compare pairs, in address order, on m_config.jobs threads. Rows and
+	// totals must come out as if processPair() was called for each one.
+	virtual void processParallel(const std::vector<Strategy::Pair>& pairs) = 0;
+
+	// Remove the results of the last processPair() call for addr from the
+	// totals, before the CFGs at addr are compared again.
+	virtual void retractPair(Addr addr) = 0;
+	virtual void printTotals() = 0;
+
+	void processLoaded();
+	std::vector<std::size_t> largestFirst(const std::vector<Strategy::Pair>& pairs) const;
+	bool writesRows() const;
+	void processStream();
+	CFG* nextStreamed(CFGsContainer* container);
+
+	void processFollow();
+	void compareAgain(Addr addr);
+
 };
 
 #endif
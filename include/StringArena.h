@@ -0,0 +1,65 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#ifndef _STRINGARENA_H
+#define _STRINGARENA_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Append-only storage for the text shared by many objects, such as
+// function names. Equal strings are interned: they are stored once and
+// always get the same pointer, which stays valid until the process exits.
+class StringArena {
+public:
+	static const char* intern(const char* text, std::size_t length);
+	static const char* intern(const std::string& text) {
+		return StringArena::intern(text.data(), text.size());
+	}
+
+	static std::size_t length(const char* interned);
+
+private:
+	struct Arena {
+		std::mutex lock;
+		char* block;
+		std::size_t blockUsed;
+		std::vector<char*> blocks;
+		std::vector<const char*> table;
+		std::size_t used;
+
+		Arena() : block(0), blockUsed(0), used(0) {}
+		~Arena();
+	};
+
+	static Arena m_arena;
+
+	static void rehash(std::size_t capacity);
+
+};
+
+#endif
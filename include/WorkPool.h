@@ -0,0 +1,71 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#ifndef _WORKPOOL_H
+#define _WORKPOOL_H
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+// Run a batch of tasks on a number of workers. Each worker takes tasks
+// from the front of its own queue and steals from the back of the others
+// once it runs out, so the tasks are started about in the order given.
+class WorkPool {
+public:
+	// The calling thread is worker 0, the others are started by run().
+	typedef std::function<void(int worker, std::size_t task)> Task;
+
+	WorkPool(int workers);
+	virtual ~WorkPool();
+
+	int workers() const { return m_queues.size(); }
+
+	// Run task for each of tasks and wait for all of them.
+	void run(const std::vector<std::size_t>& tasks, const Task& task);
+
+private:
+	struct Queue {
+		std::deque<std::size_t> tasks;
+		std::mutex lock;
+	};
+
+	std::vector<Queue> m_queues;
+	std::string m_error;
+	std::mutex m_errorLock;
+
+	void work(int worker, const Task& task);
+	bool take(int worker, std::size_t& task);
+	bool steal(int worker, std::size_t& task);
+
+	WorkPool(const WorkPool&);
+	WorkPool& operator=(const WorkPool&);
+
+};
+
+#endif
@@ -0,0 +1,84 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#include <algorithm>
+
+#include <AddrFilter.h>
+
+AddrFilter::AddrFilter() : m_restricted(false) {
+}
+
+AddrFilter::AddrFilter(const std::list<std::pair<Addr, Addr> >& ranges)
+	: m_ranges(ranges.cbegin(), ranges.cend()), m_restricted(false) {
+	// Merge overlapping ranges, so a lookup is a single binary search.
+	std::sort(m_ranges.begin(), m_ranges.end());
+
+	std::vector<std::pair<Addr, Addr> >::iterator last = m_ranges.begin();
+	for (std::vector<std::pair<Addr, Addr> >::iterator it = m_ranges.begin(),
+			ed = m_ranges.end(); it != ed; it++) {
+		if (it == last)
+			continue;
+
+		if (it->first <= last->second) {
+			last->second = std::max(last->second, it->second);
+		} else {
+			last++;
+			*last = *it;
+		}
+	}
+
+	if (!m_ranges.empty())
+		m_ranges.erase(last + 1, m_ranges.end());
+}
+
+AddrFilter::~AddrFilter() {
+}
+
+bool AddrFilter::accepts(Addr addr) const {
+	if (!m_ranges.empty()) {
+		// The first range that ends at or after addr.
+		std::vector<std::pair<Addr, Addr> >::const_iterator it = std::lower_bound(
+			m_ranges.cbegin(), m_ranges.cend(), addr,
+			[](const std::pair<Addr, Addr>& range, Addr addr) { return range.second < addr; });
+		if (it == m_ranges.cend() || addr < it->first)
+			return false;
+	}
+
+	if (m_restricted)
+		return std::binary_search(m_addrs.cbegin(), m_addrs.cend(), addr);
+
+	return true;
+}
+
+void AddrFilter::restrictTo(const std::vector<Addr>& addrs) {
+	if (m_restricted) {
+		std::vector<Addr> both;
+		std::set_intersection(m_addrs.cbegin(), m_addrs.cend(),
+			addrs.cbegin(), addrs.cend(), std::back_inserter(both));
+		m_addrs.swap(both);
+	} else {
+		m_addrs = addrs;
+		m_restricted = true;
+	}
+}
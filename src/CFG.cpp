@@ -25,40 +25,39 @@
 #include <fstream>
 #include <sstream>
 #include <cassert>
+#include <vector>
 #include <algorithm>
 
 #include <CFG.h>
+#include <CFGsContainer.h>
 
-CFG::CFG(Addr addr) : m_addr(addr), m_status(CFG::UNCHECKED),
-		m_functionName("unknown"),
-		m_entryNode(new CfgNode(CfgNode::CFG_ENTRY)),
-		m_exitNode(0), m_haltNode(0) {
+// Name of the CFGs without a cfg record.
+static const char* unknownName() {
+	static const char* name = StringArena::intern("unknown", 7);
+	return name;
 }
 
-CFG::~CFG() {
-	delete m_entryNode;
-
-	if (m_exitNode)
-		delete m_exitNode;
-
-	if (m_haltNode)
-		delete m_haltNode;
+CFG::CFG(Addr addr, CfgArena& arena) : m_addr(addr), m_status(CFG::UNCHECKED),
+		m_functionName(unknownName()),
+		m_entryNode(0),
+		m_exitNode(0), m_haltNode(0), m_nodesMap(arena), m_graph(0) {
+}
 
-	for (std::map<Addr, CfgNode*>::iterator it = m_nodesMap.begin(),
-			ed = m_nodesMap.end(); it != ed; it++) {
-		delete it->second;
-	}
+// The nodes are released with the arena, the frozen layout is not.
+CFG::~CFG() {
+	if (m_graph)
+		delete m_graph;
 }
 
 CfgNode* CFG::nodeByAddr(Addr addr) const {
-	std::map<Addr, CfgNode*>::const_iterator it = m_nodesMap.find(addr);
-	return it != m_nodesMap.end() ? it->second : 0;
+	return m_nodesMap.find(addr);
 }
 
 std::list<CfgNode*> CFG::nodes() const {
 	std::list<CfgNode*> nodes;
 
-	nodes.push_back(m_entryNode);
+	if (m_entryNode)
+		nodes.push_back(m_entryNode);
 
 	if (m_exitNode)
 		nodes.push_back(m_exitNode);
@@ -66,34 +65,39 @@ std::list<CfgNode*> CFG::nodes() const {
 	if (m_haltNode)
 		nodes.push_back(m_haltNode);
 
-	std::transform(m_nodesMap.begin(), m_nodesMap.end(),
-	    std::back_inserter(nodes),
-	    [](const std::map<Addr, CfgNode*>::value_type &pair) {
-			return pair.second;
-		}
-	);
+	for (const CFG::NodesMap::Slot& slot : m_nodesMap.sorted())
+		nodes.push_back(slot.value);
 
 	return nodes;
 }
 
 void CFG::setFunctionName(const std::string& functionName) {
-	m_functionName = functionName;
+	m_functionName = StringArena::intern(functionName);
+}
+
+void CFG::setFunctionName(const char* functionName, std::size_t length) {
+	m_functionName = StringArena::intern(functionName, length);
 }
 
 void CFG::addNode(CfgNode* node) {
 	Addr addr;
 
+	// The entry node is only created with the first node, so CFGs
+	// that are just the target of calls stay small.
+	if (!m_entryNode)
+		m_entryNode = this->arena().create<CfgNode>(this->arena(), CfgNode::CFG_ENTRY);
+
 	switch (node->type()) {
 		case CfgNode::CFG_ENTRY:
 			assert(false);
 			break;
 		case CfgNode::CFG_BLOCK:
 		case CfgNode::CFG_PHANTOM:
-			addr = CfgNode::node2addr(node);
+			addr = node->addr();
 			assert(addr != 0);
 
-			assert(m_nodesMap[addr] == 0);
-			m_nodesMap[addr] = node;
+			assert(m_nodesMap.find(addr) == 0);
+			m_nodesMap.insert(addr, node);
 
 			if (addr == m_addr)
 				this->addEdge(m_entryNode, node);
@@ -111,7 +115,89 @@ void CFG::addNode(CfgNode* node) {
 			assert(false);
 	}
 
-	m_status = CFG::UNCHECKED;
+	this->setUnchecked();
+}
+
+// Make every predecessor of oldNode point to newNode instead.
+static void redirectPredecessors(CfgNode* oldNode, CfgNode* newNode) {
+	std::vector<CfgNode*> preds(oldNode->predecessors().begin(),
+		oldNode->predecessors().end());
+
+	for (CfgNode* pred : preds) {
+		pred->removeSuccessor(oldNode);
+		pred->addSuccessor(newNode);
+		newNode->addPredecessor(pred);
+	}
+
+	oldNode->clearPredecessors();
+}
+
+// Move the nodes of other, a partial CFG of the same function built from
+// records that appear later in the input, into this CFG. The result is the
+// same as if those records had been parsed into this CFG directly.
+void CFG::merge(CFG* other) {
+	assert(other != 0 && other != this);
+	assert(other->m_addr == m_addr);
+
+	// Partial CFGs created by a node record or a call keep the default name.
+	if (other->m_functionName != unknownName())
+		m_functionName = other->m_functionName;
+
+	// The entry edge is recreated when the node at our address is moved.
+	if (other->m_entryNode) {
+		for (CfgNode* succ : other->m_entryNode->successors())
+			succ->removePredecessor(other->m_entryNode);
+		other->m_entryNode->clearSuccessors();
+
+		if (!m_entryNode)
+			m_entryNode = this->arena().create<CfgNode>(this->arena(), CfgNode::CFG_ENTRY);
+	}
+
+	if (other->m_exitNode) {
+		if (m_exitNode) {
+			redirectPredecessors(other->m_exitNode, m_exitNode);
+		} else {
+			m_exitNode = other->m_exitNode;
+		}
+
+		other->m_exitNode = 0;
+	}
+
+	if (other->m_haltNode) {
+		if (m_haltNode) {
+			redirectPredecessors(other->m_haltNode, m_haltNode);
+		} else {
+			m_haltNode = other->m_haltNode;
+		}
+
+		other->m_haltNode = 0;
+	}
+
+	for (CFG::NodesMap::Iterator it = other->m_nodesMap.begin(),
+			ed = other->m_nodesMap.end(); it != ed; it++) {
+		Addr addr = it->addr;
+		CfgNode* node = it->value;
+
+		CfgNode* mine = this->nodeByAddr(addr);
+		if (!mine) {
+			m_nodesMap.insert(addr, node);
+			if (addr == m_addr)
+				this->addEdge(m_entryNode, node);
+		} else if (node->type() == CfgNode::CFG_BLOCK) {
+			// A block replaces our phantom, just like CfgNode::makeBlock does.
+			assert(mine->type() == CfgNode::CFG_PHANTOM);
+
+			redirectPredecessors(mine, node);
+			m_nodesMap.insert(addr, node);
+		} else {
+			assert(node->type() == CfgNode::CFG_PHANTOM);
+
+			redirectPredecessors(node, mine);
+		}
+	}
+	other->m_nodesMap.clear();
+
+	this->setUnchecked();
 }
 
 bool CFG::containsNode(CfgNode* node) {
@@ -126,7 +212,7 @@ bool CFG::containsNode(CfgNode* node) {
 		case CfgNode::CFG_HALT:
 			return node == m_haltNode;
 		default:
-			CfgNode* tmp = CFG::nodeByAddr(CfgNode::node2addr(node));
+			CfgNode* tmp = CFG::nodeByAddr(node->addr());
 			return tmp == node;
 	}
 }
@@ -138,7 +224,7 @@ void CFG::addEdge(CfgNode* from, CfgNode* to) {
 	from->addSuccessor(to);
 	to->addPredecessor(from);
 
-	m_status = CFG::UNCHECKED;
+	this->setUnchecked();
 }
 
 std::string dotFilter(const std::string& name) {
@@ -157,81 +243,86 @@ std::string dotFilter(const std::string& name) {
 }
 
 void CFG::compress() {
-	std::map<Addr, CfgNode*>::iterator it = m_nodesMap.begin(),
-			ed = m_nodesMap.end();
-	while (it != ed) {
-		CfgNode* node = it->second;
-		if (node->type() != CfgNode::CFG_BLOCK) {
-			it++;
+	// Blocks are merged into their predecessors in address order.
+	std::vector<CFG::NodesMap::Slot> nodes = m_nodesMap.sorted();
+	for (std::vector<CFG::NodesMap::Slot>::const_iterator it = nodes.cbegin(),
+			ed = nodes.cend(); it != ed; it++) {
+		CfgNode* node = it->value;
+		if (node->type() != CfgNode::CFG_BLOCK)
 			continue;
-		}
 
 		// Check if we only have one predecessor.
-		const std::set<CfgNode::Edge>& nodePreds = node->predecessors();
+		const CfgNode::Edges& nodePreds = node->predecessors();
 		if (nodePreds.size() != 1) {
-			it++;
 			continue;
 		}
 
 		// Check if the predecessor is a block.
-		CfgNode* pred = nodePreds.begin()->node;
+		CfgNode* pred = nodePreds.front();
 		if (pred->type() != CfgNode::CFG_BLOCK) {
-			it++;
 			continue;
 		}
 
 		// Check if the predecessor has only one successor,
 		// which must be our node.
-		const std::set<CfgNode::Edge>& predSuccs = pred->successors();
+		const CfgNode::Edges& predSuccs = pred->successors();
 		if (predSuccs.size() != 1) {
-			it++;
 			continue;
 		}
-		assert(predSuccs.begin()->node == node);
+		assert(predSuccs.front() == node);
 
 		// Check if the predecessor has no indirect jumps or calls.
-		CfgNode::BlockData* predData = static_cast<CfgNode::BlockData*>(pred->data());
-		assert(predData != 0);
+		CfgNode::BlockData* predData = pred->block();
 		if (predData->isIndirect() || predData->calls().size() > 0) {
-			it++;
 			continue;
 		}
 
 		// Check if the node's first instruction is immediately after the predecessor instruction.
-		CfgNode::BlockData* nodeData = static_cast<CfgNode::BlockData*>(node->data());
+		CfgNode::BlockData* nodeData = node->block();
 		if ((predData->addr() + predData->size()) != nodeData->addr()) {
-			it++;
 			continue;
 		}
 
 		// We can proceed to remove the node now.
 
 		// Step 1: Transfer the node instructions to the predecessor.
-		predData->addInstructions(nodeData->instructions());
+		predData->addInstructions(nodeData);
 
 		// Step 2: Fix the predecessor with all the node successors and
 		// fix all the node sucessors with the new predecessor
 		pred->clearSuccessors();
-		for (CfgNode::Edge edgeSucc : node->successors()) {
-			pred->addSuccessor(edgeSucc.node);
+		for (CfgNode* succ : node->successors()) {
+			pred->addSuccessor(succ);
 
-			bool removed = edgeSucc.node->removePredecessor(node);
+			bool removed = succ->removePredecessor(node);
 			assert(removed);
-			edgeSucc.node->addPredecessor(pred);
+			succ->addPredecessor(pred);
 		}
 
 		// Step 3: Remove the node from the CFG.
-		it = m_nodesMap.erase(it);
-		delete node;
+		bool erased = m_nodesMap.erase(it->addr);
+		assert(erased);
+		(void) erased;
 	}
 
+	this->setUnchecked();
+}
+
+// Any change to the nodes or edges drops the frozen layout.
+void CFG::setUnchecked() {
 	m_status = CFG::UNCHECKED;
+
+	if (m_graph) {
+		delete m_graph;
+		m_graph = 0;
+	}
 }
 
 enum CFG::Status CFG::check() {
+	this->setUnchecked();
 	m_status = CFG::INVALID;
 
-	if (!m_exitNode && !m_haltNode)
+	if (!m_entryNode || (!m_exitNode && !m_haltNode))
 		goto out;
 
 	if (m_entryNode->hasPredecessor() || !m_entryNode->hasSuccessors() ||
@@ -239,9 +330,9 @@ enum CFG::Status CFG::check() {
 		(m_haltNode && (m_haltNode->hasSuccessors() || !m_haltNode->hasPredecessor())))
 		goto out;
 
-	for (std::map<Addr, CfgNode*>::iterator it = m_nodesMap.begin(),
+	for (CFG::NodesMap::Iterator it = m_nodesMap.begin(),
 			ed = m_nodesMap.end(); it != ed; it++) {
-		CfgNode* node = it->second;
+		CfgNode* node = it->value;
 		assert(node != 0);
 
 		if (!node->hasPredecessor() ||
@@ -250,15 +341,18 @@ enum CFG::Status CFG::check() {
 	}
 
 	m_status = CFG::VALID;
+	m_graph = new CfgGraph(this);
 
 out:
 	return m_status;
 }
 
-std::string CFG::toDOT() const {
+std::string CFG::toDOT(const CFGsContainer& container) const {
 	std::stringstream ss;
 	int unknown = 1;
 
+	const CfgGraph& graph = this->graph();
+
 	ss << std::hex;
 	ss << "digraph \"0x" << m_addr << "\" {" << std::endl;
 	ss << "  label = \"0x" << m_addr << " (" << m_functionName << ")\"" << std::endl;
@@ -266,11 +360,22 @@ std::string CFG::toDOT() const {
     ss << "  node[shape=record]" << std::endl;
     ss << std::endl;
 
-	std::list<CfgNode*> nodes = this->nodes();
-	for (std::list<CfgNode*>::const_iterator it = nodes.cbegin(),
-			ed = nodes.cend(); it != ed; it++) {
-		CfgNode* node = *it;
-		switch (node->type()) {
+	// Entry, exit and halt are declared first, like in CFG::nodes().
+	std::vector<CfgGraph::Index> order;
+	order.reserve(graph.size());
+	order.push_back(graph.entry());
+	if (graph.exit() != CfgGraph::NONE)
+		order.push_back(graph.exit());
+	if (graph.halt() != CfgGraph::NONE)
+		order.push_back(graph.halt());
+
+	for (CfgGraph::Index node = 1, count = graph.size(); node < count; node++) {
+		if (node != graph.exit() && node != graph.halt())
+			order.push_back(node);
+	}
+
+	for (CfgGraph::Index node : order) {
+		switch (graph.type(node)) {
 			case CfgNode::CFG_ENTRY:
 			    ss << "  Entry [label=\"\",width=0.3,height=0.3,shape=circle,fillcolor=black,style=filled]" << std::endl;
 			    break;
@@ -281,77 +386,65 @@ std::string CFG::toDOT() const {
 				ss << "  Halt [label=\"\",width=0.3,height=0.3,shape=square,fillcolor=black,style=filled,peripheries=2]" << std::endl;
 			    break;
 			case CfgNode::CFG_BLOCK: {
-				assert(node->data() != 0);
-				CfgNode::BlockData* blockData = static_cast<CfgNode::BlockData*>(node->data());
-
-				Addr addr =  blockData->addr();
+				Addr addr = graph.addr(node);
 				ss << "  \"0x" << addr << "\" [label=\"{" << std::endl;
-				ss << "    0x" << addr << " [" << std::dec << blockData->size() << "]\\l" << std::endl;
+				ss << "    0x" << addr << " [" << std::dec << graph.blockSize(node) << "]\\l" << std::endl;
 				ss << "    | [instrs]\\l" << std::endl;
 
-				std::list<Instruction*> instrs = blockData->instructions();
-				for (std::list<Instruction*>::const_iterator it = instrs.cbegin(), ed = instrs.cend();
-						it != ed; it++) {
-					Instruction* instr = *it;
-					ss << "    &nbsp;&nbsp;0x" << std::hex << instr->addr() << " \\<+"
-							<< std::dec << instr->size() << "\\>: " << dotFilter(instr->text())
-							<< "\\l" << std::endl;
+				for (InstrRun::Entry instr : graph.instructions(node)) {
+					Instruction* known = Instruction::find(instr.addr);
+					ss << "    &nbsp;&nbsp;0x" << std::hex << instr.addr << " \\<+"
+							<< std::dec << instr.size << "\\>: "
+							<< dotFilter(known ? known->text() : "???") << "\\l" << std::endl;
 				}
 
-				std::set<CFG*> calls = blockData->calls();
+				CfgGraph::Range<Addr> calls = graph.calls(node);
 				if (!calls.empty()) {
 					ss << "     | [calls]\\l" << std::endl;
 					ss << std::hex;
-					for (std::set<CFG*>::const_iterator it = calls.cbegin(), ed = calls.cend();
-							it != ed; it++) {
-						CFG* called = *it;
-						ss << "     &nbsp;&nbsp;0x" << called->addr() << " ("
-							<< dotFilter(called->functionName()) << ")\\l" << std::endl;
+					for (Addr called : calls) {
+						CFG* calledCfg = container.cfg(called);
+						ss << "     &nbsp;&nbsp;0x" << called << " ("
+							<< dotFilter(calledCfg ? calledCfg->functionName() : unknownName())
+							<< ")\\l" << std::endl;
 					}
 				}
 
 				ss << "  }\"]" << std::endl;
 
-                if (blockData->isIndirect()) {
+                if (graph.isIndirect(node)) {
                 		ss << "  \"Unknown" << std::dec << unknown << "\" [label=\"?\", shape=none]" << std::endl;
-                		ss << "  \"0x" << std::hex << blockData->addr() << "\" -> \"Unknown" << std::dec << unknown << "\" [style=dashed]" << std::endl;
+                		ss << "  \"0x" << std::hex << addr << "\" -> \"Unknown" << std::dec << unknown << "\" [style=dashed]" << std::endl;
                     unknown++;
                 }
 
 				ss << std::hex;
 				break;
 			}
-			case CfgNode::CFG_PHANTOM: {
-				assert(node->data() != 0);
-				CfgNode::PhantomData* phantomData = static_cast<CfgNode::PhantomData*>(node->data());
-
-				ss << "  \"0x" << phantomData->addr() << "\" [label=\"{" << std::endl;
-				ss << "     0x" << phantomData->addr() << "\\l" << std::endl;
+			case CfgNode::CFG_PHANTOM:
+				ss << "  \"0x" << graph.addr(node) << "\" [label=\"{" << std::endl;
+				ss << "     0x" << graph.addr(node) << "\\l" << std::endl;
 				ss << "  }\", style=dashed]" << std::endl;
 
 				break;
-			}
 			default:
 				assert(false);
 		}
 
-		std::set<CfgNode::Edge> succs = node->successors();
-		for (std::set<CfgNode::Edge>::iterator it = succs.begin(), ed = succs.end();
-				it != ed; it++) {
-			switch (node->type()) {
+		for (CfgGraph::Index succ : graph.successors(node)) {
+			switch (graph.type(node)) {
 				case CfgNode::CFG_ENTRY:
 					ss << "  Entry -> ";
 					break;
 				case CfgNode::CFG_BLOCK:
 				case CfgNode::CFG_PHANTOM:
-					ss << "  \"0x" << CfgNode::node2addr(node) << "\" -> ";
+					ss << "  \"0x" << graph.addr(node) << "\" -> ";
 					break;
 				default:
 					assert(false);
 			}
 
-			CfgNode* succ = it->node;
-			switch (succ->type()) {
+			switch (graph.type(succ)) {
 				case CfgNode::CFG_EXIT:
 					ss << "Exit";
 					break;
@@ -360,7 +453,7 @@ std::string CFG::toDOT() const {
 					break;
 				case CfgNode::CFG_BLOCK:
 				case CfgNode::CFG_PHANTOM:
-					ss << "\"0x" << CfgNode::node2addr(succ) << "\"";
+					ss << "\"0x" << graph.addr(succ) << "\"";
 					break;
 				case CfgNode::CFG_ENTRY:
 				default:
@@ -375,11 +468,11 @@ std::string CFG::toDOT() const {
 	return ss.str();
 }
 
-void CFG::dumpDOT(const std::string& fileName) {
+void CFG::dumpDOT(const std::string& fileName, const CFGsContainer& container) {
 	std::ofstream fout(fileName);
 	if (!fout.is_open())
 		throw std::string("Unable to write file: ") + fileName;
 
-	fout << this->toDOT();
+	fout << this->toDOT(container);
 	fout.close();
 }
@@ -23,84 +23,811 @@
 */
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
 #include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
 #include <cassert>
 #include <algorithm>
+#include <thread>
+#include <vector>
+#include <strings.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <CFGsContainer.h>
+#include <MappedFile.h>
+#include <Decompressor.h>
+#include <Snapshot.h>
+#include <ScanKernels.h>
+
+// Compressed input is decompressed into a window of at least this size,
+// reading at least WINDOW_MIN_READ bytes at a time.
+#define WINDOW_SIZE     (4 * 1024 * 1024)
+#define WINDOW_MIN_READ (1024 * 1024)
+
+// Streams drop the input they have read in steps of this size.
+#define STREAM_DISCARD_SIZE (16 * 1024 * 1024)
+
+// The snapshot cache of file.cfgs is file.cfgb.
+static std::string snapshotName(const std::string& filename) {
+	std::size_t n = filename.rfind(".cfgs");
+	if (n != std::string::npos && n + 5 == filename.size())
+		return filename.substr(0, n) + ".cfgb";
+	else
+		return filename + ".cfgb";
+}
 
-CFGsContainer::CFGsContainer(const std::string& filename, const std::string& name)
-	: m_input(filename, std::fstream::in), m_name(name) {
-	m_input >> std::noskipws;
+CFGsContainer::CFGsContainer(const std::string& filename, const std::string& name,
+		const CFGsContainer::Options& options)
+	: m_file(0), m_reader(0), m_cursor(0), m_limit(0), m_refillAt(0), m_mark(0),
+	  m_filter(0), m_streamOwner(0), m_streamDiscarded(0),
+	  m_followFd(-1), m_followOffset(0), m_followPending(0), m_changed(0),
+	  m_pipeFd(-1), m_name(name), m_filename(filename), m_arena(new CfgArena()),
+	  m_inputSize(0), m_sourceSize(0), m_loadTime(0) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Standard input and pipes can only be read once, from start to end,
+	// through the window. They have no cache or index.
+	if (isPipe(filename)) {
+		if (options.follow)
+			throw std::string("Unable to follow a pipe: ") + filename;
+
+		if (filename == "-") {
+			m_pipeFd = STDIN_FILENO;
+		} else {
+			m_pipeFd = open(filename.c_str(), O_RDONLY);
+			if (m_pipeFd < 0)
+				throw std::string("Unable to open file: ") + filename;
+		}
 
-	m_currentToken = nextToken();
-	processCFGs();
+		m_window.resize(WINDOW_SIZE);
+		refill();
+
+		if (Decompressor::format(m_cursor, m_limit - m_cursor) != Decompressor::NONE)
+			throw std::string("Unable to read compressed input from a pipe, "
+					"decompress it in the pipe instead: ") + filename;
+
+		if (!options.filter.isEmpty()) {
+			m_streamFilter = options.filter;
+			m_filter = &m_streamFilter;
+		}
+
+		m_currentToken = nextToken();
+
+		if (options.stream)
+			return;
+
+		processCFGs();
+
+		closePipe();
+		std::vector<char>().swap(m_window);
+		m_cursor = m_limit = m_refillAt = 0;
+		m_filter = 0;
+
+		m_loadTime = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count();
+		return;
+	}
+
+	m_file = new MappedFile(filename);
+	m_inputSize = m_sourceSize = m_file->size();
+	m_sourceMtime = m_file->mtime();
+
+	if (!options.filter.isEmpty())
+		m_filter = &options.filter;
+
+	// Compressed input can only be read from start to end.
+	bool compressed = (Decompressor::format(*m_file) != Decompressor::NONE);
+
+	if (options.follow) {
+		if (validSnapshot(*m_file) || compressed)
+			throw std::string("Unable to follow snapshot or compressed file: ") + filename;
+
+		delete m_file;
+		m_file = 0;
+
+		m_followFd = open(filename.c_str(), O_RDONLY);
+		if (m_followFd < 0)
+			throw std::string("Unable to open file: ") + filename;
+
+		if (m_filter) {
+			m_streamFilter = *m_filter;
+			m_filter = &m_streamFilter;
+		}
 
-	m_input.close();
+		std::set<Addr> changed;
+		update(changed);
+
+		m_loadTime = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count();
+		return;
+	}
+
+	if (options.stream) {
+		if (validSnapshot(*m_file))
+			throw std::string("Unable to stream snapshot file: ") + filename;
+
+		// Keep the input mapped, next() reads it one CFG at a time.
+		if (m_filter) {
+			m_streamFilter = *m_filter;
+			m_filter = &m_streamFilter;
+		}
+
+		m_file->adviseSequential();
+		if (compressed) {
+			m_reader = new Decompressor(*m_file);
+			m_window.resize(WINDOW_SIZE);
+			refill();
+		} else {
+			setInput(m_file->begin(), m_file->end());
+			m_streamDiscarded = m_file->begin();
+		}
+
+		m_currentToken = nextToken();
+		return;
+	}
+
+	if (validSnapshot(*m_file)) {
+		loadSnapshot(*m_file);
+	} else if (options.index && m_filter && !compressed &&
+			loadIndexed(filename, options.filter)) {
+		// Only the selected CFGs were loaded.
+	} else if (!options.cache || !loadCache(filename)) {
+		m_file->adviseSequential();
+
+		// The snapshot cache must hold every CFG of the input.
+		if (options.cache)
+			m_filter = 0;
+
+		if (compressed)
+			parseCompressed();
+		else if (options.jobs > 1)
+			parseParallel(options.jobs);
+		else
+			parse(m_file->begin(), m_file->end());
+
+		if (options.cache) {
+			try {
+				saveSnapshot(snapshotName(filename));
+			} catch (const std::string& e) {
+				std::cerr << "Warning: " << e << std::endl;
+			}
+		}
+
+		// The index holds offsets in the uncompressed input.
+		if (options.index && !compressed)
+			delete openIndex(filename);
+	}
+
+	delete m_file;
+	m_file = 0;
+	m_cursor = m_limit = m_refillAt = 0;
+	m_filter = 0;
+
+	m_loadTime = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
 }
 
+// Partial container for one chunk of the input, see parseParallel().
+CFGsContainer::CFGsContainer(const char* begin, const char* end, const AddrFilter* filter)
+	: m_file(0), m_reader(0), m_cursor(0), m_limit(0), m_refillAt(0), m_mark(0),
+	  m_filter(filter), m_streamOwner(0), m_streamDiscarded(0),
+	  m_followFd(-1), m_followOffset(0), m_followPending(0), m_changed(0),
+	  m_pipeFd(-1), m_arena(new CfgArena()), m_inputSize(end - begin), m_sourceSize(0),
+	  m_loadTime(0) {
+	parse(begin, end);
+	m_cursor = m_limit = m_refillAt = 0;
+	m_filter = 0;
+}
+
+// The arenas release the memory of the CFGs at once.
 CFGsContainer::~CFGsContainer() {
-	for (std::map<Addr, CFG*>::iterator it = m_cfgsMap.begin(),
-			ed = m_cfgsMap.end(); it != ed; it++) {
-		delete it->second;
-	}
+	this->destroyAll();
+
+	delete m_arena;
+	for (CfgArena* arena : m_adopted)
+		delete arena;
+
+	if (m_reader)
+		delete m_reader;
+
+	if (m_file)
+		delete m_file;
+
+	if (m_followFd >= 0)
+		close(m_followFd);
+
+	closePipe();
+}
+
+// Whether filename is standard input (-) or anything else that is not a
+// regular file, such as a FIFO or a /dev/fd/N of a process substitution.
+bool CFGsContainer::isPipe(const std::string& filename) {
+	if (filename == "-")
+		return true;
+
+	struct stat st;
+	return stat(filename.c_str(), &st) == 0 &&
+			!S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode);
+}
+
+void CFGsContainer::closePipe() {
+	if (m_pipeFd > STDIN_FILENO)
+		close(m_pipeFd);
+
+	m_pipeFd = -1;
 }
 
 CFG* CFGsContainer::cfg(Addr addr) const {
-	std::map<Addr, CFG*>::const_iterator it = m_cfgsMap.find(addr);
-	return it != m_cfgsMap.end() ? it->second : 0;
+	return m_cfgsMap.find(addr);
 }
 
 std::set<CFG*> CFGsContainer::cfgs() const {
 	std::set<CFG*> cfgs;
 
-	std::transform(m_cfgsMap.begin(), m_cfgsMap.end(),
-		std::inserter(cfgs, cfgs.begin()),
-		[](const std::map<Addr, CFG*>::value_type &pair) {
-			return pair.second;
-		}
-	);
+	for (AddrMap<CFG>::Iterator it = m_cfgsMap.begin(),
+			ed = m_cfgsMap.end(); it != ed; it++)
+		cfgs.insert(it->value);
 
 	return cfgs;
 }
 
+// The CFGs in address order, sorted once from the hash index.
+std::vector<CFG*> CFGsContainer::sortedCfgs() const {
+	std::vector<CFG*> cfgs;
+	cfgs.reserve(m_cfgsMap.size());
+
+	for (const AddrMap<CFG>::Slot& slot : m_cfgsMap.sorted())
+		cfgs.push_back(slot.value);
+
+	return cfgs;
+}
+
+// Read the next CFG of a stream, whose records must be grouped and sorted
+// by CFG address. The container then holds only that CFG, which is freed
+// by the following call.
+// Return 0 at the end of the input.
+CFG* CFGsContainer::next() {
+	assert(m_file != 0 || m_pipeFd >= 0);
+
+	this->dropAll();
+
+	// The input already read is not needed anymore.
+	if (m_file && !m_reader && m_currentToken.text - m_streamDiscarded >= STREAM_DISCARD_SIZE) {
+		m_file->discard(m_currentToken.text);
+		m_streamDiscarded = m_currentToken.text;
+	}
+
+	CFG* current = 0;
+	while (true) {
+		switch (m_currentToken.type) {
+			case Lexeme::TKN_BRACKET_OPEN:
+				matchToken(Lexeme::TKN_BRACKET_OPEN);
+				break;
+			case Lexeme::TKN_BRACKET_CLOSE:
+				matchToken(Lexeme::TKN_BRACKET_CLOSE);
+				break;
+			case Lexeme::TKN_CFG:
+			case Lexeme::TKN_NODE:
+			{
+				Addr owner = this->recordOwner();
+				if (owner < m_streamOwner) {
+					std::stringstream ss;
+					ss << std::hex << "Input " << m_name << " (" << m_filename
+						<< ") is not sorted by CFG address: 0x" << owner
+						<< " follows 0x" << m_streamOwner
+						<< "; sort its records by CFG address or compare it without -S";
+					throw ss.str();
+				}
+
+				if (current && owner != current->addr())
+					return current;
+
+				m_streamOwner = owner;
+				this->processRecord();
+
+				if (!current && (!m_filter || m_filter->accepts(owner)))
+					current = this->cfg(owner);
+
+				break;
+			}
+			default:
+				return current;
+		}
+	}
+}
+
+// End of the last complete top-level group in [begin, end), or begin if
+// there is none yet.
+static const char* completeGroups(const char* begin, const char* end) {
+	const char* complete = begin;
+
+	int depth = 0;
+	for (const char* ptr = begin; ptr < end; ptr++) {
+		switch (*ptr) {
+			case '[':
+				depth++;
+				break;
+			case ']':
+				if (--depth == 0)
+					complete = ptr + 1;
+				break;
+			case '"':
+				ptr = static_cast<const char*>(std::memchr(ptr + 1, '"', end - ptr - 1));
+				if (!ptr)
+					return complete;
+				break;
+			case '#':
+				ptr = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+				if (!ptr)
+					return complete;
+				break;
+			default:
+				break;
+		}
+	}
+
+	return complete;
+}
+
+// Parse the complete groups appended to a followed input since the last
+// call, and add the addresses of the CFGs they touch to changed. If the
+// input shrank, it was rewritten: every CFG is dropped, added to changed,
+// and the input is read again from the start. Return whether any CFG
+// changed.
+bool CFGsContainer::update(std::set<Addr>& changed) {
+	assert(m_followFd >= 0);
+
+	struct stat st;
+	if (fstat(m_followFd, &st) != 0)
+		throw std::string("Unable to stat input ") + m_name;
+
+	std::size_t size = st.st_size;
+	if (size < m_followOffset) {
+		for (AddrMap<CFG>::Iterator it = m_cfgsMap.begin(),
+				ed = m_cfgsMap.end(); it != ed; it++)
+			changed.insert(it->addr);
+
+		this->dropAll();
+
+		m_followOffset = m_followPending = 0;
+	}
+
+	if (size > m_followOffset) {
+		m_window.resize(m_followPending + (size - m_followOffset));
+
+		std::size_t read = 0;
+		while (m_followOffset < size) {
+			ssize_t n = pread(m_followFd, &m_window[m_followPending + read],
+					size - m_followOffset, m_followOffset);
+			if (n < 0)
+				throw std::string("Unable to read input ") + m_name;
+			if (n == 0)
+				break;
+
+			read += n;
+			m_followOffset += n;
+		}
+
+		const char* begin = &m_window[0];
+		const char* end = begin + m_followPending + read;
+		const char* complete = completeGroups(begin, end);
+
+		m_changed = &changed;
+		parse(begin, complete);
+		m_changed = 0;
+
+		// Keep the incomplete group for the next update.
+		m_followPending = end - complete;
+		std::memmove(&m_window[0], complete, m_followPending);
+
+		m_inputSize = m_followOffset;
+	}
+
+	return !changed.empty();
+}
+
 void CFGsContainer::compressAll() {
-	for (std::map<Addr, CFG*>::iterator it = m_cfgsMap.begin(),
+	for (AddrMap<CFG>::Iterator it = m_cfgsMap.begin(),
 			ed = m_cfgsMap.end(); it != ed; it++) {
-		CFG* cfg = it->second;
+		CFG* cfg = it->value;
 		cfg->compress();
 	}
 }
 
 void CFGsContainer::checkAll() {
-	for (std::map<Addr, CFG*>::iterator it = m_cfgsMap.begin(),
+	for (AddrMap<CFG>::Iterator it = m_cfgsMap.begin(),
 			ed = m_cfgsMap.end(); it != ed; it++) {
-		CFG* cfg = it->second;
+		CFG* cfg = it->value;
 		cfg->check();
 	}
 }
 
 void CFGsContainer::dumpAll(const char* directory) {
-	for (std::map<Addr, CFG*>::iterator it = m_cfgsMap.begin(),
-			ed = m_cfgsMap.end(); it != ed; it++) {
-		CFG* cfg = it->second;
+	for (CFG* cfg : this->sortedCfgs()) {
 		if (cfg->status() != CFG::VALID)
 			continue;
 
 		std::stringstream ss;
 		ss << directory << "/cfg" << m_name << "-0x" << std::hex << cfg->addr() << ".dot";
-		cfg->dumpDOT(ss.str());
+		cfg->dumpDOT(ss.str(), *this);
+	}
+}
+
+// Return the header of file if it is a complete snapshot, or 0 otherwise.
+const SnapshotHeader* CFGsContainer::validSnapshot(const MappedFile& file) {
+	if (file.size() < sizeof(SnapshotHeader))
+		return 0;
+
+	const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(file.data());
+	if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0)
+		return 0;
+
+	if (header->version != SNAPSHOT_VERSION)
+		throw std::string("Unsupported snapshot version: ") + file.filename();
+
+	uint64_t size = sizeof(SnapshotHeader) +
+			header->cfgs * sizeof(SnapshotCfg) +
+			header->nodes * sizeof(SnapshotNode) +
+			header->signals * sizeof(SnapshotSignal) +
+			header->calls * sizeof(uint64_t) +
+			header->succs * sizeof(uint64_t) +
+			header->sizes + header->names;
+	if (size != file.size())
+		throw std::string("Truncated snapshot file: ") + file.filename();
+
+	return header;
+}
+
+void CFGsContainer::loadSnapshot(const MappedFile& file) {
+	const SnapshotHeader* header = validSnapshot(file);
+	assert(header != 0);
+
+	const SnapshotCfg* cfgs = reinterpret_cast<const SnapshotCfg*>(header + 1);
+	const SnapshotNode* nodes = reinterpret_cast<const SnapshotNode*>(cfgs + header->cfgs);
+	const SnapshotSignal* signals = reinterpret_cast<const SnapshotSignal*>(nodes + header->nodes);
+	const uint64_t* calls = reinterpret_cast<const uint64_t*>(signals + header->signals);
+	const uint64_t* succs = calls + header->calls;
+	const uint8_t* sizes = reinterpret_cast<const uint8_t*>(succs + header->succs);
+	const char* names = reinterpret_cast<const char*>(sizes + header->sizes);
+
+	// Check that every node stays within its arrays before building anything.
+	uint64_t nNodes = 0, nSignals = 0, nCalls = 0, nSuccs = 0, nSizes = 0;
+	for (uint64_t i = 0; i < header->cfgs; i++) {
+		if (cfgs[i].name + cfgs[i].nameLength > header->names)
+			throw std::string("Corrupted snapshot file: ") + file.filename();
+
+		nNodes += cfgs[i].nodes;
+	}
+
+	if (nNodes != header->nodes)
+		throw std::string("Corrupted snapshot file: ") + file.filename();
+
+	for (uint64_t i = 0; i < header->nodes; i++) {
+		nSizes += nodes[i].instrs;
+		nCalls += nodes[i].calls;
+		nSignals += nodes[i].signals;
+		nSuccs += nodes[i].succs;
+	}
+
+	if (nSizes != header->sizes || nCalls != header->calls ||
+		nSignals != header->signals || nSuccs != header->succs)
+		throw std::string("Corrupted snapshot file: ") + file.filename();
+
+	m_sourceSize = header->sourceSize;
+	m_sourceMtime.tv_sec = header->sourceMtimeSec;
+	m_sourceMtime.tv_nsec = header->sourceMtimeNsec;
+
+	for (uint64_t i = 0; i < header->cfgs; i++) {
+		if (m_filter && !m_filter->accepts(cfgs[i].addr)) {
+			for (uint32_t n = 0; n < cfgs[i].nodes; n++, nodes++) {
+				sizes += nodes->instrs;
+				calls += nodes->calls;
+				signals += nodes->signals;
+				succs += nodes->succs;
+			}
+
+			continue;
+		}
+
+		CFG* cfg = this->cfgOrNew(cfgs[i].addr);
+		cfg->setFunctionName(names + cfgs[i].name, cfgs[i].nameLength);
+
+		for (uint32_t n = 0; n < cfgs[i].nodes; n++, nodes++) {
+			Addr addr = nodes->addr;
+
+			CfgNode* block = this->addBlock(cfg, addr);
+			CfgNode::BlockData* blockData = block->block();
+
+			for (uint32_t k = 0; k < nodes->instrs; k++)
+				blockData->addInstruction(*sizes++);
+
+			for (uint32_t k = 0; k < nodes->calls; k++)
+				blockData->addCall(*calls++);
+
+			for (uint32_t k = 0; k < nodes->signals; k++, signals++)
+				blockData->addSignalHandler(signals->sigid, signals->addr);
+
+			blockData->setIndirect(nodes->indirect != 0);
+
+			for (uint32_t k = 0; k < nodes->succs; k++) {
+				uint64_t to = *succs++;
+
+				CfgNode* succ;
+				if (to == SNAPSHOT_SUCC_EXIT)
+					succ = this->exitNode(cfg);
+				else if (to == SNAPSHOT_SUCC_HALT)
+					succ = this->haltNode(cfg);
+				else
+					succ = this->nodeOrPhantom(cfg, to);
+
+				cfg->addEdge(block, succ);
+			}
+		}
+	}
+}
+
+// Load the snapshot cache of filename if it is up to date with it.
+bool CFGsContainer::loadCache(const std::string& filename) {
+	MappedFile* cache;
+	try {
+		cache = new MappedFile(snapshotName(filename));
+	} catch (const std::string& e) {
+		return false;
+	}
+
+	bool loaded = false;
+	try {
+		const SnapshotHeader* header = validSnapshot(*cache);
+		if (header &&
+			header->sourceSize == m_sourceSize &&
+			header->sourceMtimeSec == m_sourceMtime.tv_sec &&
+			header->sourceMtimeNsec == m_sourceMtime.tv_nsec) {
+			loadSnapshot(*cache);
+			m_inputSize = cache->size();
+			loaded = true;
+		}
+	} catch (const std::string& e) {
+		// A broken cache is simply rebuilt.
+	}
+
+	delete cache;
+	return loaded;
+}
+
+// Open the index of filename, (re)building it first if needed.
+// Return 0 if there is no up to date index and it cannot be written.
+CfgsIndex* CFGsContainer::openIndex(const std::string& filename) {
+	std::string indexname = CfgsIndex::indexName(filename);
+
+	try {
+		CfgsIndex* index = new CfgsIndex(indexname);
+		if (index->isUpToDate(m_sourceSize, m_sourceMtime))
+			return index;
+
+		delete index;
+	} catch (const std::string& e) {
+		// Missing or broken, build it below.
+	}
+
+	CfgsIndex::RecordsMap records;
+	scanRecords(records);
+
+	try {
+		CfgsIndex::write(indexname, records, m_sourceSize, m_sourceMtime);
+		return new CfgsIndex(indexname);
+	} catch (const std::string& e) {
+		std::cerr << "Warning: " << e << std::endl;
+		return 0;
+	}
+}
+
+// Find the byte range of every cfg and node record in the input and file
+// it under the CFG it belongs to. Only tokens are read, nothing is built.
+void CFGsContainer::scanRecords(CfgsIndex::RecordsMap& records) {
+	const char* base = m_file->begin();
+	setInput(base, m_file->end());
+
+	int depth = 0;
+	const char* start = 0;
+	const char* last = m_cursor;
+	Addr owner = 0;
+	bool wantOwner = false;
+
+	m_currentToken = nextToken();
+	while (m_currentToken.type > Lexeme::TKN_EOF) {
+		const Lexeme& lex = m_currentToken;
+
+		// A record ends where the next one starts or its group closes.
+		bool atGroup = (depth == 1);
+		bool newRecord = atGroup &&
+				(lex.type == Lexeme::TKN_CFG || lex.type == Lexeme::TKN_NODE);
+		if (start && (newRecord || (atGroup && lex.type == Lexeme::TKN_BRACKET_CLOSE))) {
+			records[owner].push_back(CfgsIndex::Range(start - base, last - start));
+			start = 0;
+		}
+
+		if (wantOwner) {
+			owner = (lex.type == Lexeme::TKN_ADDR ? lex.data.addr : 0);
+			wantOwner = false;
+		}
+
+		if (newRecord) {
+			start = lex.text;
+			wantOwner = true;
+		} else if (lex.type == Lexeme::TKN_BRACKET_OPEN) {
+			depth++;
+		} else if (lex.type == Lexeme::TKN_BRACKET_CLOSE) {
+			depth--;
+		}
+
+		last = m_cursor;
+		m_currentToken = nextToken();
+	}
+
+	if (start)
+		records[owner].push_back(CfgsIndex::Range(start - base, last - start));
+}
+
+// Parse only the records of the CFGs accepted by filter, using the index.
+bool CFGsContainer::loadIndexed(const std::string& filename, const AddrFilter& filter) {
+	CfgsIndex* index = openIndex(filename);
+	if (!index)
+		return false;
+
+	const char* base = m_file->begin();
+	std::vector<CfgsIndex::Range> records = index->select(filter);
+	delete index;
+
+	for (const CfgsIndex::Range& range : records) {
+		if (range.offset + range.length > m_file->size())
+			throw std::string("Invalid index file: ") + CfgsIndex::indexName(filename);
+
+		setInput(base + range.offset, base + range.offset + range.length);
+
+		m_currentToken = nextToken();
+		processRecord();
+	}
+
+	m_inputSize = 0;
+	for (const CfgsIndex::Range& range : records)
+		m_inputSize += range.length;
+
+	return true;
+}
+
+void CFGsContainer::saveSnapshot(const std::string& filename) const {
+	SnapshotHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.sourceSize = m_sourceSize;
+	header.sourceMtimeSec = m_sourceMtime.tv_sec;
+	header.sourceMtimeNsec = m_sourceMtime.tv_nsec;
+
+	std::vector<SnapshotCfg> cfgs;
+	std::vector<SnapshotNode> nodes;
+	std::vector<SnapshotSignal> signals;
+	std::vector<uint64_t> calls;
+	std::vector<uint64_t> succs;
+	std::vector<uint8_t> sizes;
+	std::string names;
+
+	for (CFG* cfg : this->sortedCfgs()) {
+		std::string name = cfg->functionName();
+
+		SnapshotCfg scfg;
+		scfg.addr = cfg->addr();
+		scfg.name = names.size();
+		scfg.nameLength = name.size();
+		scfg.nodes = 0;
+		names += name;
+
+		for (CfgNode* node : cfg->nodes()) {
+			if (node->type() != CfgNode::CFG_BLOCK)
+				continue;
+
+			const CfgNode::BlockData* blockData = node->block();
+
+			SnapshotNode snode;
+			std::memset(&snode, 0, sizeof(snode));
+			snode.addr = blockData->addr();
+			snode.instrs = blockData->countInstructions();
+			snode.calls = blockData->calls().size();
+			snode.signals = blockData->signalHandlers().size();
+			snode.succs = node->successors().size();
+			snode.indirect = blockData->isIndirect() ? 1 : 0;
+			nodes.push_back(snode);
+			scfg.nodes++;
+
+			for (InstrRun::Entry instr : blockData->instructions()) {
+				if (instr.size > 0xff)
+					throw std::string("Instruction too large for snapshot: ") + filename;
+
+				sizes.push_back(instr.size);
+			}
+
+			for (Addr call : blockData->calls())
+				calls.push_back(call);
+
+			for (const CfgNode::BlockData::SignalHandler& handler : blockData->signalHandlers()) {
+				SnapshotSignal ssignal;
+				ssignal.sigid = handler.sigid;
+				ssignal.addr = handler.addr;
+				signals.push_back(ssignal);
+			}
+
+			for (CfgNode* succ : node->successors()) {
+				switch (succ->type()) {
+					case CfgNode::CFG_EXIT:
+						succs.push_back(SNAPSHOT_SUCC_EXIT);
+						break;
+					case CfgNode::CFG_HALT:
+						succs.push_back(SNAPSHOT_SUCC_HALT);
+						break;
+					default:
+						succs.push_back(succ->addr());
+						break;
+				}
+			}
+		}
+
+		cfgs.push_back(scfg);
+	}
+
+	header.cfgs = cfgs.size();
+	header.nodes = nodes.size();
+	header.signals = signals.size();
+	header.calls = calls.size();
+	header.succs = succs.size();
+	header.sizes = sizes.size();
+	header.names = names.size();
+
+	// Write to a temporary file first, so readers never see a partial snapshot.
+	std::string tmpname = filename + ".tmp";
+	std::ofstream fout(tmpname, std::ofstream::binary);
+	if (!fout.is_open())
+		throw std::string("Unable to write file: ") + tmpname;
+
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fout.write(reinterpret_cast<const char*>(cfgs.data()), cfgs.size() * sizeof(SnapshotCfg));
+	fout.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(SnapshotNode));
+	fout.write(reinterpret_cast<const char*>(signals.data()), signals.size() * sizeof(SnapshotSignal));
+	fout.write(reinterpret_cast<const char*>(calls.data()), calls.size() * sizeof(uint64_t));
+	fout.write(reinterpret_cast<const char*>(succs.data()), succs.size() * sizeof(uint64_t));
+	fout.write(reinterpret_cast<const char*>(sizes.data()), sizes.size());
+	fout.write(names.data(), names.size());
+	fout.close();
+
+	if (!fout || std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+		std::remove(tmpname.c_str());
+		throw std::string("Unable to write file: ") + filename;
 	}
 }
 
 inline
-int nextChar(std::fstream& input) {
-	if (input.eof())
+int CFGsContainer::nextChar() {
+	if (m_cursor == m_limit)
 		return -1;
 
-	char ch;
-	input >> ch;
-	return ch;
+	return (unsigned char) *m_cursor++;
+}
+
+inline
+void CFGsContainer::putbackChar(int c) {
+	if (c != -1)
+		m_cursor--;
+}
+
+inline
+bool isKeyword(const char* text, std::size_t length, const char* keyword) {
+	return length == std::strlen(keyword) &&
+			strncasecmp(text, keyword, length) == 0;
 }
 
 CFGsContainer::Lexeme CFGsContainer::nextToken() {
@@ -108,45 +835,51 @@ CFGsContainer::Lexeme CFGsContainer::nextToken() {
 
     int state = 1;
     while (state != 9) {
-        int c = nextChar(m_input);
+		// Between tokens, make sure the next line is complete.
+		if (state == 1 && m_cursor > m_refillAt)
+			refill();
+
+        int c = nextChar();
         switch (state) {
             case 1:
-            		if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+				lex.text = m_cursor - 1;
+
+            		if (isSpaceChar(c)) {
+					m_cursor = skipSpaces(m_cursor, m_limit);
 					state = 1;
 				} else if (c == '0') {
-					lex.token += (char) c;
 					lex.type = Lexeme::TKN_NUMBER;
 					lex.data.number = 0;
 					state = 2;
 				} else if (c >= '1' && c <= '9') {
-					lex.token += (char) c;
+					uint64_t number = 0;
+					m_cursor = scanDecimal(lex.text, m_limit, number);
+
 					lex.type = Lexeme::TKN_NUMBER;
-					state = 4;
+					lex.data.number = number;
+					state = 9;
 				} else if (std::isalpha(c)) {
-					lex.token += (char) std::tolower(c);
 					state = 5;
 				} else if (c == '[') {
-					lex.token += (char) c;
 					lex.type = Lexeme::TKN_BRACKET_OPEN;
 					state = 9;
 				} else if (c == ']') {
-					lex.token += (char) c;
 					lex.type = Lexeme::TKN_BRACKET_CLOSE;
 					state = 9;
 				} else if (c == ':') {
-					lex.token += (char) c;
 					lex.type = Lexeme::TKN_COLON;
 					state = 9;
 				} else if (c == '\"') {
 					lex.type = Lexeme::TKN_TEXT;
+					lex.text = m_cursor;
 					state = 6;
 				} else if (c == '-') {
-					lex.token += (char) c;
 					state = 7;
 				} else if (c == '#') {
 					state = 8;
 				} else if (c == -1) {
 					lex.type = Lexeme::TKN_EOF;
+					lex.text = m_cursor;
 					state = 9;
 				} else {
 					lex.type = Lexeme::TKN_INVALID_TOKEN;
@@ -156,72 +889,42 @@ CFGsContainer::Lexeme CFGsContainer::nextToken() {
 				break;
             case 2:
 				if (std::tolower(c) == 'x') {
-					lex.token += (char) std::tolower(c);
-					lex.type = Lexeme::TKN_ADDR;
-					state = 3;
-				} else {
-					if (c != -1)
-						m_input.putback(c);
-
-					state = 9;
-				}
-
-            		break;
-            case 3:
-				if (std::isdigit(c) ||
-					(std::tolower(c) >= 'a' && std::tolower(c) <= 'f')) {
-					lex.token += (char) std::tolower(c);
-					state = 3;
-				} else {
-					lex.data.addr = std::stoul(lex.token.substr(2), 0, 16);
-
-					if (c != -1)
-						m_input.putback(c);
-
-					state = 9;
-				}
+					uint64_t addr = 0;
+					m_cursor = scanHex(m_cursor, m_limit, addr);
 
-            		break;
-            case 4:
-				if (std::isdigit(c)) {
-					lex.token += (char) c;
-					state = 4;
+					lex.type = Lexeme::TKN_ADDR;
+					lex.data.addr = addr;
 				} else {
-					lex.data.number = std::stoull(lex.token);
-
-					if (c != -1)
-						m_input.putback(c);
-
-					state = 9;
+					putbackChar(c);
 				}
 
+				state = 9;
             		break;
             case 5:
 				if (std::isalpha(c)) {
-					lex.token += (char) std::tolower(c);
 					state = 5;
 				} else {
-					if (lex.token == "cfg") {
+					putbackChar(c);
+
+					std::size_t length = m_cursor - lex.text;
+					if (isKeyword(lex.text, length, "cfg")) {
 						lex.type = Lexeme::TKN_CFG;
-					} else if (lex.token == "node") {
+					} else if (isKeyword(lex.text, length, "node")) {
 						lex.type = Lexeme::TKN_NODE;
-					} else if (lex.token == "exit") {
+					} else if (isKeyword(lex.text, length, "exit")) {
 						lex.type = Lexeme::TKN_EXIT;
-					} else if (lex.token == "halt") {
+					} else if (isKeyword(lex.text, length, "halt")) {
 						lex.type = Lexeme::TKN_HALT;
-					} else if (lex.token == "true") {
+					} else if (isKeyword(lex.text, length, "true")) {
 						lex.type = Lexeme::TKN_BOOL;
 						lex.data.boolean = true;
-					} else if (lex.token == "false") {
+					} else if (isKeyword(lex.text, length, "false")) {
 						lex.type = Lexeme::TKN_BOOL;
 						lex.data.boolean = false;
 					} else {
 						lex.type = Lexeme::TKN_INVALID_TOKEN;
 					}
 
-					if (c != -1)
-						m_input.putback(c);
-
 					state = 9;
 				}
 
@@ -231,10 +934,11 @@ CFGsContainer::Lexeme CFGsContainer::nextToken() {
 					lex.type = Lexeme::TKN_UNEXPECTED_EOF;
 					state = 9;
 				} else {
-					if (c == '\"')
-						state = 9;
-					else {
-						lex.token += (char) c;
+					if (c == '\"') {
+						// Leave the closing quote out of the text.
+						lex.length = (m_cursor - 1) - lex.text;
+						return lex;
+					} else {
 						state = 6;
 					}
 				}
@@ -247,7 +951,6 @@ CFGsContainer::Lexeme CFGsContainer::nextToken() {
 				} else {
 					if (c == '>') {
 						lex.type = Lexeme::TKN_ARROW;
-						lex.token += (char) c;
 						state = 9;
 					} else {
 						lex.type = Lexeme::TKN_INVALID_TOKEN;
@@ -258,12 +961,17 @@ CFGsContainer::Lexeme CFGsContainer::nextToken() {
 				break;
 			case 8:
 				if (c == -1) {
+					lex.type = Lexeme::TKN_EOF;
+					lex.text = m_cursor;
 					state = 9;
+				} else if (c == '\n') {
+					state = 1;
 				} else {
-					if (c == '\n')
-						state = 1;
-					else
-						state = 8;
+					// Jump to the end of the line, or of the input.
+					const char* eol = static_cast<const char*>(
+						std::memchr(m_cursor, '\n', m_limit - m_cursor));
+					m_cursor = eol ? eol : m_limit;
+					state = 8;
 				}
 
 				break;
@@ -274,9 +982,261 @@ CFGsContainer::Lexeme CFGsContainer::nextToken() {
 		}
 	}
 
+	lex.length = m_cursor - lex.text;
 	return lex;
 }
 
+void CFGsContainer::parse(const char* begin, const char* end) {
+	setInput(begin, end);
+
+	m_currentToken = nextToken();
+	processCFGs();
+}
+
+// Parse the input while it is decompressed on another thread.
+void CFGsContainer::parseCompressed() {
+	m_reader = new Decompressor(*m_file);
+	m_window.resize(WINDOW_SIZE);
+	refill();
+
+	m_currentToken = nextToken();
+	processCFGs();
+
+	delete m_reader;
+	m_reader = 0;
+	std::vector<char>().swap(m_window);
+}
+
+inline
+void CFGsContainer::setInput(const char* begin, const char* end) {
+	m_cursor = begin;
+	m_limit = end;
+
+	// Input in memory is never refilled.
+	m_refillAt = end;
+}
+
+// Read up to size bytes of the decompressed input or the pipe.
+// Return 0 at the end.
+std::size_t CFGsContainer::readInput(char* buffer, std::size_t size) {
+	if (m_reader)
+		return m_reader->read(buffer, size);
+
+	while (true) {
+		ssize_t n = ::read(m_pipeFd, buffer, size);
+		if (n >= 0) {
+			m_inputSize += n;
+			return n;
+		}
+
+		if (errno != EINTR)
+			throw std::string("Unable to read input ") + m_name + ": " + m_filename;
+	}
+}
+
+// Slide the unread input to the front of the window and append more of the
+// decompressed input or the pipe, at least up to the end of a line, so that
+// no token is cut at the end of the window. Only the unread input is kept,
+// from m_mark when it is set, so pointers to the input already read become
+// invalid. Return false at the end.
+bool CFGsContainer::refill() {
+	if (!m_reader && m_pipeFd < 0)
+		return false;
+
+	const char* keep = m_mark ? m_mark : m_cursor;
+	std::size_t unread = m_cursor - keep;
+
+	std::size_t size = m_limit - keep;
+	if (size > 0)
+		std::memmove(&m_window[0], keep, size);
+
+	std::size_t read = 0;
+	const char* eol = 0;
+	while (!eol) {
+		if (m_window.size() - size < WINDOW_MIN_READ)
+			m_window.resize(m_window.size() * 2);
+
+		std::size_t n = readInput(&m_window[size], m_window.size() - size);
+		if (n == 0)
+			break;
+
+		eol = static_cast<const char*>(memrchr(&m_window[size], '\n', n));
+		size += n;
+		read += n;
+	}
+
+	if (m_mark)
+		m_mark = &m_window[0];
+
+	m_cursor = &m_window[0] + unread;
+	m_limit = &m_window[0] + size;
+	m_refillAt = eol ? eol : m_limit;
+
+	return read > 0;
+}
+
+// Find the next top-level group at or after from: a line that starts
+// with a bracket followed by a cfg or node record.
+static const char* nextGroup(const char* from, const char* begin, const char* end) {
+	const char* ptr = from;
+	while (ptr < end) {
+		if (ptr == begin || ptr[-1] == '\n') {
+			if (*ptr == '[') {
+				const char* tmp = ptr + 1;
+				while (tmp < end && std::isspace((unsigned char) *tmp))
+					tmp++;
+
+				std::size_t length = 0;
+				while ((tmp + length) < end && std::isalpha((unsigned char) tmp[length]))
+					length++;
+
+				if (isKeyword(tmp, length, "cfg") || isKeyword(tmp, length, "node"))
+					return ptr;
+			}
+		}
+
+		ptr = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+		if (!ptr)
+			break;
+
+		ptr++;
+	}
+
+	return end;
+}
+
+// Split the input at top-level groups and parse each chunk on its own thread
+// into a partial container. The partial containers are then merged in input
+// order, so the result is the same as parsing the whole file serially.
+void CFGsContainer::parseParallel(int jobs) {
+	const char* begin = m_file->begin();
+	const char* end = m_file->end();
+
+	std::vector<const char*> bounds;
+	bounds.push_back(begin);
+	for (int i = 1; i < jobs; i++) {
+		const char* from = begin + (m_file->size() / jobs) * i;
+		if (from < bounds.back())
+			from = bounds.back();
+
+		const char* bound = nextGroup(from, begin, end);
+		if (bound != bounds.back() && bound != end)
+			bounds.push_back(bound);
+	}
+	bounds.push_back(end);
+
+	std::size_t chunks = bounds.size() - 1;
+	std::vector<CFGsContainer*> partials(chunks, 0);
+	std::vector<std::thread> workers;
+	for (std::size_t i = 1; i < chunks; i++) {
+		const AddrFilter* filter = m_filter;
+		workers.push_back(std::thread([&partials, &bounds, i, filter]() {
+			partials[i] = new CFGsContainer(bounds[i], bounds[i+1], filter);
+		}));
+	}
+
+	// The first chunk is parsed by this thread directly into this container.
+	parse(bounds[0], bounds[1]);
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	for (std::size_t i = 1; i < chunks; i++) {
+		this->merge(partials[i]);
+		delete partials[i];
+	}
+}
+
+// Take over the CFGs of other, along with its arenas. CFGs that we already
+// have are merged into ours and their emptied shells stay in the arenas.
+void CFGsContainer::merge(CFGsContainer* other) {
+	for (AddrMap<CFG>::Iterator it = other->m_cfgsMap.begin(),
+			ed = other->m_cfgsMap.end(); it != ed; it++) {
+		CFG* cfg = this->cfg(it->addr);
+		if (cfg)
+			cfg->merge(it->value);
+		else
+			m_cfgsMap.insert(it->addr, it->value);
+	}
+
+	other->m_cfgsMap.clear();
+
+	m_adopted.push_back(other->m_arena);
+	m_adopted.insert(m_adopted.end(), other->m_adopted.begin(), other->m_adopted.end());
+	other->m_arena = 0;
+	other->m_adopted.clear();
+}
+
+// Forget every CFG and release the memory they used.
+void CFGsContainer::dropAll() {
+	this->destroyAll();
+	m_cfgsMap.clear();
+
+	m_arena->reset();
+	for (CfgArena* arena : m_adopted)
+		delete arena;
+	m_adopted.clear();
+}
+
+// Destroy the CFGs before their arenas are released, which gives back
+// what they keep outside of them.
+void CFGsContainer::destroyAll() {
+	for (AddrMap<CFG>::Iterator it = m_cfgsMap.begin(), ed = m_cfgsMap.end(); it != ed; it++)
+		it->value->~CFG();
+}
+
+CFG* CFGsContainer::cfgOrNew(Addr addr) {
+	CFG* cfg = this->cfg(addr);
+	if (!cfg) {
+		cfg = m_arena->create<CFG>(addr, *m_arena);
+		m_cfgsMap.insert(addr, cfg);
+	}
+
+	return cfg;
+}
+
+CfgNode* CFGsContainer::addBlock(CFG* cfg, Addr addr) {
+	CfgNode* block = cfg->nodeByAddr(addr);
+	if (block) {
+		block->makeBlock();
+	} else {
+		block = m_arena->create<CfgNode>(*m_arena, CfgNode::CFG_BLOCK, addr);
+		cfg->addNode(block);
+	}
+
+	return block;
+}
+
+CfgNode* CFGsContainer::nodeOrPhantom(CFG* cfg, Addr addr) {
+	CfgNode* node = cfg->nodeByAddr(addr);
+	if (!node) {
+		node = m_arena->create<CfgNode>(*m_arena, CfgNode::CFG_PHANTOM, addr);
+		cfg->addNode(node);
+	}
+
+	return node;
+}
+
+CfgNode* CFGsContainer::exitNode(CFG* cfg) {
+	CfgNode* node = cfg->exitNode();
+	if (!node) {
+		node = m_arena->create<CfgNode>(*m_arena, CfgNode::CFG_EXIT);
+		cfg->addNode(node);
+	}
+
+	return node;
+}
+
+CfgNode* CFGsContainer::haltNode(CFG* cfg) {
+	CfgNode* node = cfg->haltNode();
+	if (!node) {
+		node = m_arena->create<CfgNode>(*m_arena, CfgNode::CFG_HALT);
+		cfg->addNode(node);
+	}
+
+	return node;
+}
+
 void CFGsContainer::matchToken(enum Lexeme::Type type) {
 	if (m_currentToken.type == type) {
 		m_currentToken = nextToken();
@@ -290,186 +1250,214 @@ void CFGsContainer::processCFGs() {
 		matchToken(Lexeme::TKN_BRACKET_OPEN);
 
 		while (m_currentToken.type == Lexeme::TKN_CFG ||
-			   m_currentToken.type == Lexeme::TKN_NODE) {
-			switch (m_currentToken.type) {
-				case Lexeme::TKN_CFG:
-				{
-					matchToken(Lexeme::TKN_CFG);
-
-					Addr addr = m_currentToken.data.addr;
-					matchToken(Lexeme::TKN_ADDR);
-
-					if (m_currentToken.type == Lexeme::TKN_COLON) {
-						matchToken(Lexeme::TKN_COLON);
-						matchToken(Lexeme::TKN_NUMBER);
-					}
+			   m_currentToken.type == Lexeme::TKN_NODE)
+			processRecord();
 
-					CFG* cfg = this->cfg(addr);
-					if (!cfg) {
-						cfg = new CFG(addr);
-						m_cfgsMap[addr] = cfg;
-					}
+		matchToken(Lexeme::TKN_BRACKET_CLOSE);
+	}
+}
+
+void CFGsContainer::processRecord() {
+	if (m_filter && skipRecord())
+		return;
 
-					std::string name = m_currentToken.token;
-					matchToken(Lexeme::TKN_TEXT);
-					cfg->setFunctionName(name);
+	switch (m_currentToken.type) {
+		case Lexeme::TKN_CFG:
+		{
+			matchToken(Lexeme::TKN_CFG);
 
-					bool complete = m_currentToken.data.boolean;
-					matchToken(Lexeme::TKN_BOOL);
-					(void) complete;
+			Addr addr = m_currentToken.data.addr;
+			matchToken(Lexeme::TKN_ADDR);
 
-					break;
+			if (m_currentToken.type == Lexeme::TKN_COLON) {
+				matchToken(Lexeme::TKN_COLON);
+				matchToken(Lexeme::TKN_NUMBER);
+			}
+
+			CFG* cfg = this->cfgOrNew(addr);
+			if (m_changed)
+				m_changed->insert(addr);
+
+			cfg->setFunctionName(m_currentToken.text, m_currentToken.length);
+			matchToken(Lexeme::TKN_TEXT);
+
+			bool complete = m_currentToken.data.boolean;
+			matchToken(Lexeme::TKN_BOOL);
+			(void) complete;
+
+			break;
+		}
+		case Lexeme::TKN_NODE:
+		{
+			matchToken(Lexeme::TKN_NODE);
+
+			Addr addr = m_currentToken.data.addr;
+			matchToken(Lexeme::TKN_ADDR);
+
+			// The cfg record may be in another chunk, not selected by the
+			// index or yet to be appended, so the node record creates the CFG.
+			CFG* cfg = this->cfgOrNew(addr);
+
+			if (m_changed)
+				m_changed->insert(addr);
+
+			addr = m_currentToken.data.addr;
+			matchToken(Lexeme::TKN_ADDR);
+
+			CfgNode* block = this->addBlock(cfg, addr);
+			CfgNode::BlockData* blockData = block->block();
+
+			int block_size = m_currentToken.data.number;
+			matchToken(Lexeme::TKN_NUMBER);
+
+			matchToken(Lexeme::TKN_BRACKET_OPEN);
+			while (m_currentToken.type == Lexeme::TKN_NUMBER) {
+				int instr_size = m_currentToken.data.number;
+				matchToken(Lexeme::TKN_NUMBER);
+
+				blockData->addInstruction(instr_size);
+				addr += instr_size;
+			}
+			matchToken(Lexeme::TKN_BRACKET_CLOSE);
+
+			// assert((addr - blockData->addr()) == block_size);
+
+			matchToken(Lexeme::TKN_BRACKET_OPEN);
+			while (m_currentToken.type == Lexeme::TKN_ADDR) {
+				addr = m_currentToken.data.addr;
+				matchToken(Lexeme::TKN_ADDR);
+
+				if (m_currentToken.type == Lexeme::TKN_COLON) {
+					matchToken(Lexeme::TKN_COLON);
+					matchToken(Lexeme::TKN_NUMBER);
 				}
-				case Lexeme::TKN_NODE:
-				{
-					matchToken(Lexeme::TKN_NODE);
 
-					Addr addr = m_currentToken.data.addr;
-					matchToken(Lexeme::TKN_ADDR);
+				blockData->addCall(addr);
+			}
+			matchToken(Lexeme::TKN_BRACKET_CLOSE);
 
-					CFG* cfg = this->cfg(addr);
-					assert(cfg != 0);
+			matchToken(Lexeme::TKN_BRACKET_OPEN);
+			while (m_currentToken.type == Lexeme::TKN_NUMBER) {
+				int sigid = m_currentToken.data.number;
+				matchToken(Lexeme::TKN_NUMBER);
 
-					addr = m_currentToken.data.addr;
-					matchToken(Lexeme::TKN_ADDR);
+				matchToken(Lexeme::TKN_ARROW);
 
-					CfgNode::BlockData* blockData = new CfgNode::BlockData(addr);
-					CfgNode* block = cfg->nodeByAddr(addr);
-					if (block) {
-						assert(block->type() == CfgNode::CFG_PHANTOM);
-						block->setData(blockData);
-					} else {
-						block = new CfgNode(CfgNode::CFG_BLOCK);
-						block->setData(blockData);
-						cfg->addNode(block);
-					}
+				addr = m_currentToken.data.addr;
+				matchToken(Lexeme::TKN_ADDR);
 
-					int block_size = m_currentToken.data.number;
+				if (m_currentToken.type == Lexeme::TKN_COLON) {
+					matchToken(Lexeme::TKN_COLON);
 					matchToken(Lexeme::TKN_NUMBER);
+				}
 
-					matchToken(Lexeme::TKN_BRACKET_OPEN);
-					while (m_currentToken.type == Lexeme::TKN_NUMBER) {
-						int instr_size = m_currentToken.data.number;
-						matchToken(Lexeme::TKN_NUMBER);
+				blockData->addSignalHandler(sigid, addr);
+			}
+			matchToken(Lexeme::TKN_BRACKET_CLOSE);
 
-						blockData->addInstruction(Instruction::get(addr, instr_size));
-						addr += instr_size;
-					}
-					matchToken(Lexeme::TKN_BRACKET_CLOSE);
+			bool indirection = m_currentToken.data.boolean;
+			matchToken(Lexeme::TKN_BOOL);
 
-					// assert((addr - blockData->addr()) == block_size);
+			blockData->setIndirect(indirection);
 
-					matchToken(Lexeme::TKN_BRACKET_OPEN);
-					while (m_currentToken.type == Lexeme::TKN_ADDR) {
+			matchToken(Lexeme::TKN_BRACKET_OPEN);
+			while (m_currentToken.type == Lexeme::TKN_ADDR ||
+				   m_currentToken.type == Lexeme::TKN_EXIT ||
+				   m_currentToken.type == Lexeme::TKN_HALT) {
+				CfgNode* succ;
+				switch (m_currentToken.type) {
+					case Lexeme::TKN_ADDR:
 						addr = m_currentToken.data.addr;
 						matchToken(Lexeme::TKN_ADDR);
 
-						if (m_currentToken.type == Lexeme::TKN_COLON) {
-							matchToken(Lexeme::TKN_COLON);
-							matchToken(Lexeme::TKN_NUMBER);
-						}
+						succ = this->nodeOrPhantom(cfg, addr);
+						break;
+					case Lexeme::TKN_EXIT:
+						matchToken(Lexeme::TKN_EXIT);
 
-						CFG* call = this->cfg(addr);
-						if (!call) {
-							call = new CFG(addr);
-							m_cfgsMap[addr] = call;
-						}
+						succ = this->exitNode(cfg);
+						break;
+					case Lexeme::TKN_HALT:
+						matchToken(Lexeme::TKN_HALT);
 
-						blockData->addCall(call);
-					}
-					matchToken(Lexeme::TKN_BRACKET_CLOSE);
+						succ = this->haltNode(cfg);
+						break;
+					default:
+						assert(false);
+				}
 
-					matchToken(Lexeme::TKN_BRACKET_OPEN);
-					while (m_currentToken.type == Lexeme::TKN_NUMBER) {
-						int sigid = m_currentToken.data.number;
-						matchToken(Lexeme::TKN_NUMBER);
+				if (m_currentToken.type == Lexeme::TKN_COLON) {
+					matchToken(Lexeme::TKN_COLON);
+					matchToken(Lexeme::TKN_NUMBER);
+				}
 
-						matchToken(Lexeme::TKN_ARROW);
+				cfg->addEdge(block, succ);
+			}
+			matchToken(Lexeme::TKN_BRACKET_CLOSE);
 
-						addr = m_currentToken.data.addr;
-						matchToken(Lexeme::TKN_ADDR);
+			break;
+		}
+		default:
+			assert(false);
+	}
+}
 
-						if (m_currentToken.type == Lexeme::TKN_COLON) {
-							matchToken(Lexeme::TKN_COLON);
-							matchToken(Lexeme::TKN_NUMBER);
-						}
+// Skip the current record if the filter rejects the CFG it belongs to,
+// without building anything. Return whether the record was skipped.
+bool CFGsContainer::skipRecord() {
+	assert(m_filter != 0);
 
-						CFG* handler = this->cfg(addr);
-						if (!handler) {
-							handler = new CFG(addr);
-							m_cfgsMap[addr] = handler;
-						}
+	Addr owner = this->recordOwner();
+	if (owner == 0 || m_filter->accepts(owner))
+		return false;
 
-						blockData->addSignalHandler(sigid, handler);
-					}
-					matchToken(Lexeme::TKN_BRACKET_CLOSE);
-
-					bool indirection = m_currentToken.data.boolean;
-					matchToken(Lexeme::TKN_BOOL);
-
-					blockData->setIndirect(indirection);
-
-					matchToken(Lexeme::TKN_BRACKET_OPEN);
-					while (m_currentToken.type == Lexeme::TKN_ADDR ||
-						   m_currentToken.type == Lexeme::TKN_EXIT ||
-						   m_currentToken.type == Lexeme::TKN_HALT) {
-						CfgNode* succ;
-						switch (m_currentToken.type) {
-							case Lexeme::TKN_ADDR:
-								addr = m_currentToken.data.addr;
-								matchToken(Lexeme::TKN_ADDR);
-
-								if (!(succ = cfg->nodeByAddr(addr))) {
-									CfgNode::PhantomData* phantomData =
-											new CfgNode::PhantomData(addr);
-
-									succ = new CfgNode(CfgNode::CFG_PHANTOM);
-									succ->setData(phantomData);
-
-									cfg->addNode(succ);
-								}
-
-								break;
-							case Lexeme::TKN_EXIT:
-								matchToken(Lexeme::TKN_EXIT);
-
-								succ = cfg->exitNode();
-								if (!succ) {
-									succ = new CfgNode(CfgNode::CFG_EXIT);
-									cfg->addNode(succ);
-								}
-
-								break;
-							case Lexeme::TKN_HALT:
-								matchToken(Lexeme::TKN_HALT);
-
-								succ = cfg->haltNode();
-								if (!succ) {
-									succ = new CfgNode(CfgNode::CFG_HALT);
-									cfg->addNode(succ);
-								}
-
-								break;
-							default:
-								assert(false);
-						}
-
-						if (m_currentToken.type == Lexeme::TKN_COLON) {
-							matchToken(Lexeme::TKN_COLON);
-							matchToken(Lexeme::TKN_NUMBER);
-						}
-
-						cfg->addEdge(block, succ);
-					}
-					matchToken(Lexeme::TKN_BRACKET_CLOSE);
+	if (m_currentToken.type == Lexeme::TKN_CFG) {
+		matchToken(Lexeme::TKN_CFG);
+		matchToken(Lexeme::TKN_ADDR);
 
-					break;
-				}
-				default:
-					assert(false);
+		if (m_currentToken.type == Lexeme::TKN_COLON) {
+			matchToken(Lexeme::TKN_COLON);
+			matchToken(Lexeme::TKN_NUMBER);
+		}
+
+		matchToken(Lexeme::TKN_TEXT);
+		matchToken(Lexeme::TKN_BOOL);
+	} else {
+		assert(m_currentToken.type == Lexeme::TKN_NODE);
+		matchToken(Lexeme::TKN_NODE);
+
+		// The rest of a node record is four bracketed lists, so it ends
+		// at the fourth closing bracket. Scan for it without lexing.
+		int lists = 0;
+		while (lists < 4) {
+			if (m_cursor == m_limit && !refill())
+				break;
+
+			char c = *m_cursor++;
+			if (c == ']') {
+				lists++;
+			} else if (c == '#') {
+				const char* eol = static_cast<const char*>(
+						std::memchr(m_cursor, '\n', m_limit - m_cursor));
+				m_cursor = eol ? eol : m_limit;
 			}
 		}
+		assert(lists == 4);
 
-		matchToken(Lexeme::TKN_BRACKET_CLOSE);
+		m_currentToken = nextToken();
 	}
+
+	return true;
+}
+
+// Return the address of the CFG the current record belongs to, without
+// consuming any token, or 0 if it does not start with one.
+Addr CFGsContainer::recordOwner() {
+	// The token may lie past a refill, which moves the window.
+	m_mark = m_cursor;
+	Lexeme lex = nextToken();
+	m_cursor = m_mark;
+	m_mark = 0;
+
+	return lex.type == Lexeme::TKN_ADDR ? lex.data.addr : 0;
 }
@@ -0,0 +1,80 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#include <cassert>
+
+#include <CfgArena.h>
+
+// Objects are carved out of blocks of this size. Larger requests, such as
+// the slot vectors of large AddrMaps or spilled SmallVector storage, get
+// blocks of their own.
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_LARGE_SIZE (ARENA_BLOCK_SIZE / 4)
+
+CfgArena::CfgArena() : m_block(0), m_used(0), m_size(0) {
+}
+
+CfgArena::~CfgArena() {
+	for (char* block : m_blocks)
+		delete[] block;
+}
+
+void* CfgArena::allocate(std::size_t size, std::size_t align) {
+	assert(align > 0 && (align & (align - 1)) == 0);
+
+	if (size > ARENA_LARGE_SIZE) {
+		// new[] aligns for any fundamental type.
+		char* large = new char[size];
+		m_blocks.push_back(large);
+		m_size += size;
+
+		return large;
+	}
+
+	std::size_t offset = (m_used + align - 1) & ~(align - 1);
+	if (!m_block || offset + size > ARENA_BLOCK_SIZE) {
+		m_block = new char[ARENA_BLOCK_SIZE];
+		m_blocks.push_back(m_block);
+		m_size += ARENA_BLOCK_SIZE;
+		offset = 0;
+	}
+
+	m_used = offset + size;
+	return m_block + offset;
+}
+
+void CfgArena::reset() {
+	for (char* block : m_blocks) {
+		if (block != m_block)
+			delete[] block;
+	}
+
+	m_blocks.clear();
+	if (m_block)
+		m_blocks.push_back(m_block);
+
+	m_used = 0;
+	m_size = m_block ? ARENA_BLOCK_SIZE : 0;
+}
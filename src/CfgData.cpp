@@ -27,42 +27,78 @@
 #include <CfgData.h>
 #include <CFG.h>
 
-CfgData::CfgData(CFG* cfg) {
-	for (CfgNode* node : cfg->nodes()) {
-		Addr from = CfgNode::node2addr(node);
+CfgData::CfgData(CFG* cfg) : m_base(cfg->addr()) {
+	const CfgGraph& graph = cfg->graph();
 
-		if (node->type() == CfgNode::CFG_PHANTOM) {
-			m_phantoms.insert(from);
+	m_instrs.near.reserve(graph.countInstructions());
+	m_blocks.near.reserve(graph.size());
+	m_edges.near.reserve(graph.countEdges());
+	m_calls.near.reserve(graph.countCalls());
+
+	for (CfgGraph::Index node = 0, count = graph.size(); node < count; node++) {
+		Addr from = graph.addr(node);
+
+		if (graph.type(node) == CfgNode::CFG_PHANTOM) {
+			CfgData::add(m_phantoms, m_base, from);
 			continue;
 		}
 
-		for (CfgNode::Edge edgeSucc : node->successors()) {
-			Addr to = CfgNode::node2addr(edgeSucc.node);
-			m_edges.insert(CfgData::Edge(from, to));
-		}
+		for (CfgGraph::Index succ : graph.successors(node))
+			CfgData::add(m_edges, m_base, CfgData::Edge(from, graph.addr(succ)));
 
-		if (node->type() != CfgNode::CFG_BLOCK)
+		if (graph.type(node) != CfgNode::CFG_BLOCK)
 			continue;
 
-		assert(node->data() != 0);
-		CfgNode::BlockData* block = static_cast<CfgNode::BlockData*>(node->data());
-		m_blocks.insert(CfgData::Node(block->addr(), block->size()));
+		CfgData::add(m_blocks, m_base, CfgData::Node(from, graph.blockSize(node)));
 
-		for (Instruction* instr : block->instructions())
-			m_instrs.insert(instr->addr());
+		for (InstrRun::Entry instr : graph.instructions(node))
+			CfgData::add(m_instrs, m_base, instr.addr);
 
-		CfgData::Call call(block->addr());
-		for (CFG* calledCfg : block->calls()) {
-			call.calls.insert(calledCfg->addr());
-		}
+		for (Addr called : graph.calls(node))
+			CfgData::add(m_calls, m_base, CfgData::Call(from, called));
 
-		if (!call.calls.empty())
-			m_calls.insert(call);
-
-		if (block->isIndirect())
-			m_indirects.insert(block->addr());
+		if (graph.isIndirect(node))
+			CfgData::add(m_indirects, m_base, from);
 	}
+
+	// Blocks may overlap and the exit and halt nodes share address zero.
+	CfgData::sortUnique(m_instrs);
+	CfgData::sortUnique(m_blocks);
+	CfgData::sortUnique(m_phantoms);
+	CfgData::sortUnique(m_edges);
+	CfgData::sortUnique(m_calls);
+	CfgData::sortUnique(m_indirects);
 }
 
 CfgData::~CfgData() {
 }
+
+void CfgData::add(CfgData::Addrs& items, Addr base, Addr addr) {
+	if (RelAddr::isNear(base, addr))
+		items.near.push_back(RelAddr::encode(base, addr));
+	else
+		items.far.push_back(addr);
+}
+
+void CfgData::add(CfgData::Nodes& items, Addr base, const CfgData::Node& node) {
+	if (RelAddr::isNear(base, node.start))
+		items.near.push_back(CfgData::NearNode(RelAddr::encode(base, node.start), node.size));
+	else
+		items.far.push_back(node);
+}
+
+void CfgData::add(CfgData::Edges& items, Addr base, const CfgData::Edge& edge) {
+	if (RelAddr::isNear(base, edge.from) && RelAddr::isNear(base, edge.to))
+		items.near.push_back(CfgData::NearEdge(RelAddr::encode(base, edge.from),
+			RelAddr::encode(base, edge.to)));
+	else
+		items.far.push_back(edge);
+}
+
+void CfgData::add(CfgData::Calls& items, Addr base, const CfgData::Call& call) {
+	if (RelAddr::isNear(base, call.block_addr) && RelAddr::isNear(base, call.target))
+		items.near.push_back(CfgData::NearCall(RelAddr::encode(base, call.block_addr),
+			RelAddr::encode(base, call.target)));
+	else
+		items.far.push_back(call);
+}
@@ -0,0 +1,156 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#include <cassert>
+#include <algorithm>
+
+#include <CfgGraph.h>
+#include <CFG.h>
+
+CfgGraph::CfgGraph(const CFG* cfg) : m_exit(CfgGraph::NONE), m_halt(CfgGraph::NONE),
+		m_instrCount(0) {
+	assert(cfg->m_entryNode != 0);
+
+	std::vector<CfgNode*> nodes;
+	nodes.reserve(cfg->m_nodesMap.size() + 3);
+
+	nodes.push_back(cfg->m_entryNode);
+	for (const CFG::NodesMap::Slot& slot : cfg->m_nodesMap.sorted())
+		nodes.push_back(slot.value);
+
+	if (cfg->m_exitNode) {
+		m_exit = nodes.size();
+		nodes.push_back(cfg->m_exitNode);
+	}
+
+	if (cfg->m_haltNode) {
+		m_halt = nodes.size();
+		nodes.push_back(cfg->m_haltNode);
+	}
+
+	// Size every array up front, these are kept for the whole comparison.
+	std::size_t instrs = 0, calls = 0, succs = 0;
+	for (CfgNode* node : nodes) {
+		succs += node->successors().size();
+
+		if (node->type() == CfgNode::CFG_BLOCK) {
+			const CfgNode::BlockData* blockData = node->block();
+			instrs += blockData->instructions().encodedLength();
+			m_instrCount += blockData->countInstructions();
+			calls += blockData->calls().size();
+		}
+	}
+
+	Index count = nodes.size();
+	m_instrSizes.reserve(instrs);
+	m_calls.reserve(calls);
+	m_succs.reserve(succs);
+	m_types.reserve(count);
+	m_addrs.reserve(count);
+	m_sizes.reserve(count);
+	m_indirects.reserve(count);
+	m_instrOffsets.reserve(count + 1);
+	m_callOffsets.reserve(count + 1);
+	m_succOffsets.reserve(count + 1);
+
+	m_instrOffsets.push_back(0);
+	m_callOffsets.push_back(0);
+	for (CfgNode* node : nodes) {
+		m_types.push_back(node->type());
+		m_addrs.push_back(node->addr());
+
+		if (node->type() == CfgNode::CFG_BLOCK) {
+			const CfgNode::BlockData* blockData = node->block();
+
+			m_sizes.push_back(blockData->size());
+			m_indirects.push_back(blockData->isIndirect() ? 1 : 0);
+			InstrRun run = blockData->instructions();
+			m_instrSizes.insert(m_instrSizes.end(), run.encoded(),
+				run.encoded() + run.encodedLength());
+
+			// Called CFGs in address order.
+			Array<Addr>::Type::iterator first = m_calls.insert(m_calls.end(),
+				blockData->calls().begin(), blockData->calls().end());
+			std::sort(first, m_calls.end());
+		} else {
+			m_sizes.push_back(0);
+			m_indirects.push_back(0);
+		}
+
+		m_instrOffsets.push_back(m_instrSizes.size());
+		m_callOffsets.push_back(m_calls.size());
+	}
+
+	// Blocks and phantoms are numbered from 1 in address order, so their
+	// index is found by a binary search on the addresses.
+	const Addr* first = m_addrs.data() + 1;
+	const Addr* last = first + cfg->m_nodesMap.size();
+
+	m_succOffsets.push_back(0);
+	for (CfgNode* node : nodes) {
+		std::size_t start = m_succs.size();
+		for (CfgNode* succ : node->successors()) {
+			switch (succ->type()) {
+				case CfgNode::CFG_EXIT:
+					m_succs.push_back(m_exit);
+					break;
+				case CfgNode::CFG_HALT:
+					m_succs.push_back(m_halt);
+					break;
+				case CfgNode::CFG_BLOCK:
+				case CfgNode::CFG_PHANTOM: {
+					const Addr* pos = std::lower_bound(first, last, succ->addr());
+					assert(pos != last && *pos == succ->addr());
+					m_succs.push_back(pos - m_addrs.data());
+					break;
+				}
+				default:
+					assert(false);
+			}
+		}
+
+		std::sort(m_succs.begin() + start, m_succs.end());
+		m_succOffsets.push_back(m_succs.size());
+	}
+
+	// The predecessors are the transpose of the successors. Filling them
+	// in node order leaves every list sorted.
+	m_predOffsets.assign(count + 1, 0);
+	for (Index succ : m_succs)
+		m_predOffsets[succ + 1]++;
+
+	for (Index i = 0; i < count; i++)
+		m_predOffsets[i + 1] += m_predOffsets[i];
+
+	std::vector<Index> fill(m_predOffsets.begin(), m_predOffsets.end() - 1);
+	m_preds.resize(m_succs.size());
+	for (Index i = 0; i < count; i++) {
+		for (Index succ : this->successors(i))
+			m_preds[fill[succ]++] = i;
+	}
+}
+
+CfgGraph::~CfgGraph() {
+}
@@ -26,61 +26,39 @@
 
 #include <CFG.h>
 #include <CfgNode.h>
+#include <Instruction.h>
 
-CfgNode::CfgNode(enum CfgNode::Type type) : m_type(type), m_data(0) {
+CfgNode::CfgNode(CfgArena& arena, enum CfgNode::Type type, Addr addr) : m_type(type),
+		m_block(arena, addr) {
 }
 
+// Nodes live in the arena of their container and are released with it.
 CfgNode::~CfgNode() {
-	if (m_data)
-		delete m_data;
 }
 
-void CfgNode::setData(CfgNode::Data* data) {
-	assert(data != 0);
-
-	PhantomData* phantomData = dynamic_cast<PhantomData*>(data);
-	if (phantomData) {
-		assert(m_data == 0);
-		assert(m_type == CfgNode::CFG_PHANTOM);
-		m_data = phantomData;
-		return;
-	}
-
-	BlockData* blockData = dynamic_cast<BlockData*>(data);
-	if (blockData) {
-		switch (m_type) {
-			case CfgNode::CFG_PHANTOM:
-				assert(m_data != 0);
-				delete m_data;
-
-				m_type = CfgNode::CFG_BLOCK;
-				m_data = blockData;
-				return;
-			case CfgNode::CFG_BLOCK:
-				assert(m_data == 0);
-				m_data = blockData;
-				return;
-			default:
-				assert(false);
-		}
-	}
-
-	assert(false);
+void CfgNode::makeBlock() {
+	assert(m_type == CfgNode::CFG_PHANTOM);
+	m_type = CfgNode::CFG_BLOCK;
 }
 
 bool CfgNode::addSuccessor(CfgNode* succ) {
 	assert(this->type() != CfgNode::CFG_EXIT && this->type() != CfgNode::CFG_HALT);
 	assert(succ->type() != CfgNode::CFG_ENTRY);
 
-	return m_succs.insert(CfgNode::Edge(succ)).second;
+	if (m_succs.contains(succ))
+		return false;
+
+	m_succs.push_back(succ, *m_block.m_arena);
+	return true;
 }
 
-void CfgNode::addSuccessors(const std::set<CfgNode::Edge>& succs) {
-	m_succs.insert(succs.cbegin(), succs.cend());
+void CfgNode::addSuccessors(const CfgNode::Edges& succs) {
+	for (CfgNode* succ : succs)
+		this->addSuccessor(succ);
 }
 
 bool CfgNode::removeSuccessor(CfgNode* succ) {
-	return m_succs.erase(CfgNode::Edge(succ)) > 0;
+	return m_succs.erase(succ);
 }
 
 void CfgNode::clearSuccessors() {
@@ -92,78 +70,83 @@ bool CfgNode::addPredecessor(CfgNode* pred) {
 	assert(pred->type() != CfgNode::CFG_PHANTOM);
 	assert(pred->type() != CfgNode::CFG_EXIT && pred->type() != CfgNode::CFG_HALT);
 
-	return m_preds.insert(CfgNode::Edge(pred)).second;
+	if (m_preds.contains(pred))
+		return false;
+
+	m_preds.push_back(pred, *m_block.m_arena);
+	return true;
 }
 
-void CfgNode::addPredecessors(const std::set<CfgNode::Edge>& preds) {
-	m_preds.insert(preds.cbegin(), preds.cend());
+void CfgNode::addPredecessors(const CfgNode::Edges& preds) {
+	for (CfgNode* pred : preds)
+		this->addPredecessor(pred);
 }
 
 bool CfgNode::removePredecessor(CfgNode* pred) {
-	return m_preds.erase(CfgNode::Edge(pred)) > 0;
+	return m_preds.erase(pred);
 }
 
 void CfgNode::clearPredecessors() {
 	m_preds.clear();
 }
 
-Addr CfgNode::node2addr(CfgNode* node) {
-	switch (node->type()) {
-		case CfgNode::CFG_BLOCK:
-		case CfgNode::CFG_PHANTOM:
-			assert(node->data() != 0);
-			return node->data()->addr();
-		default:
-			return 0;
-	}
-}
-
 void CfgNode::BlockData::setIndirect(bool indirect) {
 	m_indirection = indirect;
 }
 
-void CfgNode::BlockData::addInstruction(Instruction* instr) {
-	assert(instr != 0 && instr->size() > 0);
+void CfgNode::BlockData::addInstruction(int size) {
+	assert(size > 0);
 
-	m_instrs.push_back(instr);
-	m_size += instr->size();
-}
+#ifndef NDEBUG
+	// Both inputs and the instructions map must agree on the size of an
+	// instruction, which get() asserts. Only the check needs the store.
+	Instruction::get(m_addr + m_size, size);
+#endif
 
-void CfgNode::BlockData::addInstructions(const std::list<Instruction*>& instrs) {
-	for (Instruction* instr : instrs)
-		this->addInstruction(instr);
-}
+	uint8_t encoded[InstrRun::MAX_ENCODED];
+	std::size_t length = InstrRun::encode(size, encoded);
 
-Instruction* CfgNode::BlockData::firstInstruction() const {
-	return m_instrs.empty() ? 0: m_instrs.front();
+	m_instrSizes.append(encoded, encoded + length, *m_arena);
+	m_instrCount++;
+	m_size += size;
 }
 
-Instruction* CfgNode::BlockData::lastInstruction() const {
-	return m_instrs.empty() ? 0: m_instrs.back();
+// Append the instructions of next, a block that starts right after this one.
+void CfgNode::BlockData::addInstructions(const CfgNode::BlockData* next) {
+	assert(next->m_addr == m_addr + m_size);
+
+	m_instrSizes.append(next->m_instrSizes.begin(), next->m_instrSizes.end(), *m_arena);
+	m_instrCount += next->m_instrCount;
+	m_size += next->m_size;
 }
 
 void CfgNode::BlockData::clearInstructions() {
-	m_instrs.clear();
+	m_instrSizes.clear();
+	m_instrCount = 0;
 	m_size = 0;
 }
 
-void CfgNode::BlockData::addCall(CFG* cfg) {
-	m_calls.insert(cfg);
+void CfgNode::BlockData::addCall(Addr addr) {
+	if (!m_calls.contains(addr))
+		m_calls.push_back(addr, *m_arena);
 }
 
 void CfgNode::BlockData::clearCalls() {
 	m_calls.clear();
 }
 
-void CfgNode::BlockData::addSignalHandler(int sigid, CFG* cfg) {
-	std::map<int, CFG*>::const_iterator it = m_signalHandlers.find(sigid);
-	if (it != m_signalHandlers.end()) {
-		assert(it->second->addr() == cfg->addr());
-	} else {
-		m_signalHandlers[sigid] = cfg;
+void CfgNode::BlockData::addSignalHandler(int sigid, Addr addr) {
+	for (const SignalHandler& handler : m_signalHandlers) {
+		if (handler.sigid == sigid) {
+			assert(handler.addr == addr);
+			return;
+		}
 	}
+
+	SignalHandler handler = { sigid, addr };
+	m_signalHandlers.push_back(handler, *m_arena);
 }
 
 void CfgNode::BlockData::clearSignalHandlers() {
 	m_signalHandlers.clear();
-}
\ No newline at end of file
+}
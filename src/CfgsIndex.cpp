@@ -0,0 +1,184 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#include <CfgsIndex.h>
+#include <AddrFilter.h>
+#include <MappedFile.h>
+
+#define INDEX_MAGIC    "CFGI"
+#define INDEX_VERSION  1
+
+CfgsIndex::CfgsIndex(const std::string& filename)
+	: m_file(new MappedFile(filename)), m_header(0), m_cfgs(0), m_ranges(0) {
+	if (m_file->size() < sizeof(Header)) {
+		delete m_file;
+		throw std::string("Invalid index file: ") + filename;
+	}
+
+	m_header = reinterpret_cast<const Header*>(m_file->data());
+	m_cfgs = reinterpret_cast<const Cfg*>(m_header + 1);
+	m_ranges = reinterpret_cast<const Range*>(m_cfgs + m_header->cfgs);
+
+	if (std::memcmp(m_header->magic, INDEX_MAGIC, sizeof(m_header->magic)) != 0 ||
+		m_header->version != INDEX_VERSION ||
+		(sizeof(Header) + m_header->cfgs * sizeof(Cfg) +
+			m_header->ranges * sizeof(Range)) != m_file->size()) {
+		delete m_file;
+		throw std::string("Invalid index file: ") + filename;
+	}
+
+	// Only a few records are read, scattered over the file.
+	m_file->adviseRandom();
+}
+
+CfgsIndex::~CfgsIndex() {
+	delete m_file;
+}
+
+bool CfgsIndex::isUpToDate(std::size_t sourceSize, const struct timespec& sourceMtime) const {
+	return m_header->sourceSize == sourceSize &&
+			m_header->sourceMtimeSec == sourceMtime.tv_sec &&
+			m_header->sourceMtimeNsec == sourceMtime.tv_nsec;
+}
+
+// The ranges of the records of every CFG accepted by filter, in file order.
+std::vector<CfgsIndex::Range> CfgsIndex::select(const AddrFilter& filter) const {
+	std::vector<CfgsIndex::Range> selected;
+
+	const Cfg* begin = m_cfgs;
+	const Cfg* end = m_cfgs + m_header->cfgs;
+
+	// Without ranges, every CFG is a candidate.
+	std::vector<std::pair<Addr, Addr> > ranges = filter.ranges();
+	if (ranges.empty())
+		ranges.push_back(std::make_pair(0, ~((Addr) 0)));
+
+	for (std::vector<std::pair<Addr, Addr> >::const_iterator it = ranges.cbegin(),
+			ed = ranges.cend(); it != ed; it++) {
+		const Cfg* cfg = std::lower_bound(begin, end, it->first,
+			[](const Cfg& c, Addr addr) { return c.addr < addr; });
+		for (; cfg != end && cfg->addr <= it->second; cfg++) {
+			if (!filter.accepts(cfg->addr))
+				continue;
+
+			if (cfg->first + cfg->count > m_header->ranges)
+				throw std::string("Invalid index file: ") + m_file->filename();
+
+			selected.insert(selected.end(), m_ranges + cfg->first,
+					m_ranges + cfg->first + cfg->count);
+		}
+	}
+
+	std::sort(selected.begin(), selected.end());
+	return selected;
+}
+
+// The addresses of every CFG in the index, sorted.
+std::vector<Addr> CfgsIndex::addresses() const {
+	std::vector<Addr> addrs;
+	addrs.reserve(m_header->cfgs);
+
+	for (const Cfg* cfg = m_cfgs, *end = m_cfgs + m_header->cfgs; cfg != end; cfg++)
+		addrs.push_back(cfg->addr);
+
+	return addrs;
+}
+
+// Open the index of sourceFilename if it exists and is up to date with it.
+CfgsIndex* CfgsIndex::open(const std::string& sourceFilename) {
+	struct stat st;
+	if (stat(sourceFilename.c_str(), &st) != 0)
+		return 0;
+
+	CfgsIndex* index;
+	try {
+		index = new CfgsIndex(CfgsIndex::indexName(sourceFilename));
+	} catch (const std::string& e) {
+		return 0;
+	}
+
+	if (!index->isUpToDate(st.st_size, st.st_mtim)) {
+		delete index;
+		return 0;
+	}
+
+	return index;
+}
+
+// The index of file.cfgs is file.cfgi.
+std::string CfgsIndex::indexName(const std::string& filename) {
+	std::size_t n = filename.rfind(".cfgs");
+	if (n != std::string::npos && n + 5 == filename.size())
+		return filename.substr(0, n) + ".cfgi";
+	else
+		return filename + ".cfgi";
+}
+
+void CfgsIndex::write(const std::string& filename, const CfgsIndex::RecordsMap& records,
+		std::size_t sourceSize, const struct timespec& sourceMtime) {
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+	header.version = INDEX_VERSION;
+	header.sourceSize = sourceSize;
+	header.sourceMtimeSec = sourceMtime.tv_sec;
+	header.sourceMtimeNsec = sourceMtime.tv_nsec;
+
+	std::vector<Cfg> cfgs;
+	std::vector<Range> ranges;
+	for (CfgsIndex::RecordsMap::const_iterator it = records.cbegin(),
+			ed = records.cend(); it != ed; it++) {
+		Cfg cfg;
+		cfg.addr = it->first;
+		cfg.first = ranges.size();
+		cfg.count = it->second.size();
+		cfgs.push_back(cfg);
+
+		ranges.insert(ranges.end(), it->second.begin(), it->second.end());
+	}
+
+	header.cfgs = cfgs.size();
+	header.ranges = ranges.size();
+
+	std::string tmpname = filename + ".tmp";
+	std::ofstream fout(tmpname, std::ofstream::binary);
+	if (!fout.is_open())
+		throw std::string("Unable to write file: ") + tmpname;
+
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fout.write(reinterpret_cast<const char*>(cfgs.data()), cfgs.size() * sizeof(Cfg));
+	fout.write(reinterpret_cast<const char*>(ranges.data()), ranges.size() * sizeof(Range));
+	fout.close();
+
+	if (!fout || std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+		std::remove(tmpname.c_str());
+		throw std::string("Unable to write file: ") + filename;
+	}
+}
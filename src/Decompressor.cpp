@@ -0,0 +1,364 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#include <cstring>
+#include <algorithm>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+#include <Decompressor.h>
+#include <MappedFile.h>
+
+#define DECOMPRESSOR_BLOCKS      8
+#define DECOMPRESSOR_BLOCK_SIZE  (1024 * 1024)
+
+Decompressor::Decompressor(const MappedFile& file)
+	: m_file(file), m_format(Decompressor::format(file)),
+	  m_blocks(DECOMPRESSOR_BLOCKS), m_head(0), m_count(0),
+	  m_done(false), m_stop(false), m_offset(0), m_reading(false) {
+	switch (m_format) {
+		case Decompressor::GZIP:
+#ifndef HAVE_ZLIB
+			throw std::string("Unable to read gzip file (built without zlib): ") + file.filename();
+#endif
+			break;
+		case Decompressor::ZSTD:
+#ifndef HAVE_ZSTD
+			throw std::string("Unable to read zstd file (built without zstd): ") + file.filename();
+#endif
+			break;
+		case Decompressor::XZ:
+#ifndef HAVE_LZMA
+			throw std::string("Unable to read xz file (built without liblzma): ") + file.filename();
+#endif
+			break;
+		default:
+			throw std::string("Not a compressed file: ") + file.filename();
+	}
+
+	for (Block& block : m_blocks) {
+		block.data.resize(DECOMPRESSOR_BLOCK_SIZE);
+		block.size = 0;
+	}
+
+	m_worker = std::thread(&Decompressor::run, this);
+}
+
+Decompressor::~Decompressor() {
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_stop = true;
+	}
+	m_drained.notify_all();
+
+	m_worker.join();
+}
+
+// Detect the compression format from the magic bytes at the start of data.
+enum Decompressor::Format Decompressor::format(const char* data, std::size_t size) {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+
+	if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b)
+		return Decompressor::GZIP;
+
+	if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 &&
+		bytes[2] == 0x2f && bytes[3] == 0xfd)
+		return Decompressor::ZSTD;
+
+	if (size >= 6 && std::memcmp(bytes, "\xfd" "7zXZ\0", 6) == 0)
+		return Decompressor::XZ;
+
+	return Decompressor::NONE;
+}
+
+enum Decompressor::Format Decompressor::format(const MappedFile& file) {
+	return Decompressor::format(file.data(), file.size());
+}
+
+std::size_t Decompressor::read(char* buffer, std::size_t size) {
+	Block* block = currentBlock();
+	if (!block)
+		return 0;
+
+	std::size_t n = std::min(size, block->size - m_offset);
+	std::memcpy(buffer, &block->data[m_offset], n);
+	m_offset += n;
+
+	if (m_offset == block->size)
+		popBlock();
+
+	return n;
+}
+
+bool Decompressor::getline(std::string& line) {
+	line.clear();
+
+	bool found = false;
+	while (Block* block = currentBlock()) {
+		found = true;
+
+		const char* begin = &block->data[m_offset];
+		const char* end = &block->data[0] + block->size;
+		const char* eol = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+
+		line.append(begin, eol ? eol : end);
+		m_offset = (eol ? eol + 1 : end) - &block->data[0];
+
+		if (m_offset == block->size)
+			popBlock();
+
+		if (eol)
+			break;
+	}
+
+	return found;
+}
+
+// The block at the head of the ring, waiting for it if needed,
+// or 0 at the end of the data.
+Decompressor::Block* Decompressor::currentBlock() {
+	if (!m_reading) {
+		std::unique_lock<std::mutex> guard(m_lock);
+		m_filled.wait(guard, [this]() { return m_count > 0 || m_done; });
+
+		if (m_count == 0) {
+			if (!m_error.empty())
+				throw m_error;
+
+			return 0;
+		}
+
+		m_reading = true;
+		m_offset = 0;
+	}
+
+	return &m_blocks[m_head];
+}
+
+void Decompressor::popBlock() {
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_head = (m_head + 1) % m_blocks.size();
+		m_count--;
+		m_reading = false;
+	}
+	m_drained.notify_one();
+}
+
+// The next free block of the ring, waiting for the reader to release
+// one if needed, or 0 if the reader is gone.
+Decompressor::Block* Decompressor::emptyBlock() {
+	std::unique_lock<std::mutex> guard(m_lock);
+	m_drained.wait(guard, [this]() { return m_count < m_blocks.size() || m_stop; });
+
+	if (m_stop)
+		return 0;
+
+	Block* block = &m_blocks[(m_head + m_count) % m_blocks.size()];
+	block->size = 0;
+	return block;
+}
+
+void Decompressor::pushBlock() {
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_count++;
+	}
+	m_filled.notify_one();
+}
+
+void Decompressor::run() {
+	try {
+		switch (m_format) {
+			case Decompressor::GZIP:
+				decompressGzip();
+				break;
+			case Decompressor::ZSTD:
+				decompressZstd();
+				break;
+			case Decompressor::XZ:
+				decompressXz();
+				break;
+			default:
+				break;
+		}
+	} catch (const std::string& e) {
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_error = e;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_done = true;
+	}
+	m_filled.notify_all();
+}
+
+void Decompressor::decompressGzip() {
+#ifdef HAVE_ZLIB
+	z_stream zs;
+	std::memset(&zs, 0, sizeof(zs));
+
+	// Accept both gzip and zlib headers.
+	if (inflateInit2(&zs, 15 + 32) != Z_OK)
+		throw std::string("Unable to decompress file: ") + m_file.filename();
+
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(m_file.data());
+	std::size_t remaining = m_file.size();
+
+	bool finished = false;
+	while (!finished) {
+		Block* block = emptyBlock();
+		if (!block)
+			break;
+
+		while (block->size < block->data.size()) {
+			if (zs.avail_in == 0 && remaining > 0) {
+				std::size_t chunk = std::min(remaining, (std::size_t) 1 << 30);
+				zs.next_in = const_cast<unsigned char*>(in);
+				zs.avail_in = chunk;
+				in += chunk;
+				remaining -= chunk;
+			}
+
+			zs.next_out = reinterpret_cast<unsigned char*>(&block->data[block->size]);
+			zs.avail_out = block->data.size() - block->size;
+
+			int ret = inflate(&zs, Z_NO_FLUSH);
+			block->size = block->data.size() - zs.avail_out;
+
+			if (ret == Z_STREAM_END) {
+				// Concatenated gzip members are read as one stream.
+				if (zs.avail_in == 0 && remaining == 0) {
+					finished = true;
+					break;
+				}
+
+				inflateReset(&zs);
+			} else if (ret != Z_OK) {
+				inflateEnd(&zs);
+				throw std::string(ret == Z_BUF_ERROR ? "Truncated compressed file: " :
+						"Corrupted compressed file: ") + m_file.filename();
+			}
+		}
+
+		if (block->size > 0)
+			pushBlock();
+	}
+
+	inflateEnd(&zs);
+#endif
+}
+
+void Decompressor::decompressZstd() {
+#ifdef HAVE_ZSTD
+	ZSTD_DStream* zds = ZSTD_createDStream();
+	if (!zds || ZSTD_isError(ZSTD_initDStream(zds))) {
+		ZSTD_freeDStream(zds);
+		throw std::string("Unable to decompress file: ") + m_file.filename();
+	}
+
+	ZSTD_inBuffer in = { m_file.data(), m_file.size(), 0 };
+
+	// Concatenated frames are read as one stream.
+	std::size_t pending = 1;
+	while (in.pos < in.size || pending != 0) {
+		Block* block = emptyBlock();
+		if (!block)
+			break;
+
+		ZSTD_outBuffer out = { &block->data[0], block->data.size(), 0 };
+		while (out.pos < out.size && (in.pos < in.size || pending != 0)) {
+			std::size_t before = out.pos;
+
+			pending = ZSTD_decompressStream(zds, &out, &in);
+			if (ZSTD_isError(pending)) {
+				ZSTD_freeDStream(zds);
+				throw std::string("Corrupted compressed file: ") + m_file.filename();
+			}
+
+			if (in.pos == in.size && pending != 0 && out.pos == before) {
+				ZSTD_freeDStream(zds);
+				throw std::string("Truncated compressed file: ") + m_file.filename();
+			}
+		}
+
+		block->size = out.pos;
+		if (block->size > 0)
+			pushBlock();
+	}
+
+	ZSTD_freeDStream(zds);
+#endif
+}
+
+void Decompressor::decompressXz() {
+#ifdef HAVE_LZMA
+	lzma_stream strm = LZMA_STREAM_INIT;
+
+	// Concatenated xz streams are read as one stream.
+	if (lzma_stream_decoder(&strm, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+		throw std::string("Unable to decompress file: ") + m_file.filename();
+
+	strm.next_in = reinterpret_cast<const uint8_t*>(m_file.data());
+	strm.avail_in = m_file.size();
+
+	bool finished = false;
+	while (!finished) {
+		Block* block = emptyBlock();
+		if (!block)
+			break;
+
+		while (block->size < block->data.size()) {
+			strm.next_out = reinterpret_cast<uint8_t*>(&block->data[block->size]);
+			strm.avail_out = block->data.size() - block->size;
+
+			lzma_ret ret = lzma_code(&strm, strm.avail_in == 0 ? LZMA_FINISH : LZMA_RUN);
+			block->size = block->data.size() - strm.avail_out;
+
+			if (ret == LZMA_STREAM_END) {
+				finished = true;
+				break;
+			} else if (ret != LZMA_OK) {
+				lzma_end(&strm);
+				throw std::string(ret == LZMA_BUF_ERROR ? "Truncated compressed file: " :
+						"Corrupted compressed file: ") + m_file.filename();
+			}
+		}
+
+		if (block->size > 0)
+			pushBlock();
+	}
+
+	lzma_end(&strm);
+#endif
+}
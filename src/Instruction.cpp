@@ -22,73 +22,291 @@
    The GNU General Public License is contained in the file COPYING.
 */
 
-#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <new>
+#include <cstring>
+#include <cstdint>
 #include <cassert>
 
 #include <Instruction.h>
+#include <MappedFile.h>
+#include <Decompressor.h>
+#include <ScanKernels.h>
 
-std::map<Addr, Instruction*> Instruction::m_instrsMap;
+// Each thread loading the map parses and stores it in slices of about
+// this size.
+#define LOAD_SLICE_SIZE (1024 * 1024)
 
-Instruction::Instruction(Addr addr, int size, const std::string& text) :
-	m_addr(addr), m_size(size), m_text(text) {
+// Instructions are spread over this many shards (a power of two).
+#define INSTR_SHARDS_BITS 6
+#define INSTR_SHARDS (1 << INSTR_SHARDS_BITS)
+
+// Instructions allocated at once in a slab, and the smallest table.
+#define INSTR_SLAB_SIZE 4096
+#define INSTR_TABLE_SIZE 1024
+
+Instruction::Shard Instruction::m_shards[INSTR_SHARDS];
+
+MappedFile* Instruction::m_mapFile = 0;
+std::vector<char> Instruction::m_mapBuffer;
+const char* Instruction::m_mapText = 0;
+
+// Nearby addresses go to different shards and table slots.
+static inline uint64_t addrHash(Addr addr) {
+	return (uint64_t) addr * 0x9e3779b97f4a7c15ULL;
+}
+
+static inline std::size_t shardOf(Addr addr) {
+	return addrHash(addr) >> (64 - INSTR_SHARDS_BITS);
+}
+
+Instruction::Instruction(Addr addr, int size) :
+	m_addr(addr), m_textOffset(0), m_size(size), m_textLength(0) {
 }
 
 Instruction::~Instruction() {
 }
 
+std::string Instruction::text() const {
+	if (m_textLength == 0)
+		return "???";
+
+	return std::string(m_mapText + m_textOffset, m_textLength);
+}
+
 Instruction* Instruction::get(Addr addr, int size) {
-	Instruction* instr = m_instrsMap[addr];
-	if (instr) {
-		if (instr->m_size == 0)
-			instr->m_size = size;
-		else
-			assert(instr->m_size == size);
-	} else {
-		instr = new Instruction(addr, size);
-		m_instrsMap[addr] = instr;
+	// Containers may be parsed by several threads at once.
+	Shard& shard = m_shards[shardOf(addr)];
+	std::lock_guard<std::mutex> guard(shard.lock);
+
+	return Instruction::getLocked(shard, addr, size);
+}
+
+// Return the instruction at addr, or 0 if there is none.
+Instruction* Instruction::find(Addr addr) {
+	Shard& shard = m_shards[shardOf(addr)];
+	std::lock_guard<std::mutex> guard(shard.lock);
+
+	if (shard.table.empty())
+		return 0;
+
+	std::size_t mask = shard.table.size() - 1;
+	std::size_t slot = addrHash(addr) & mask;
+	while (Instruction* instr = shard.table[slot]) {
+		if (instr->m_addr == addr)
+			return instr;
+
+		slot = (slot + 1) & mask;
 	}
 
+	return 0;
+}
+
+Instruction* Instruction::getLocked(Shard& shard, Addr addr, int size) {
+	// Keep the table at most half full.
+	if (2 * (shard.used + 1) > shard.table.size())
+		Instruction::rehash(shard, std::max<std::size_t>(INSTR_TABLE_SIZE, 2 * shard.table.size()));
+
+	std::size_t mask = shard.table.size() - 1;
+	std::size_t slot = addrHash(addr) & mask;
+	while (Instruction* instr = shard.table[slot]) {
+		if (instr->m_addr == addr) {
+			if (instr->m_size == 0)
+				instr->m_size = size;
+			else
+				assert(instr->m_size == size);
+
+			return instr;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	if (shard.slabs.empty() || shard.slabUsed == INSTR_SLAB_SIZE) {
+		shard.slabs.push_back(static_cast<Instruction*>(
+				::operator new(INSTR_SLAB_SIZE * sizeof(Instruction))));
+		shard.slabUsed = 0;
+	}
+
+	Instruction* instr = new (shard.slabs.back() + shard.slabUsed++) Instruction(addr, size);
+	shard.table[slot] = instr;
+	shard.used++;
+
 	return instr;
 }
 
-void Instruction::load(std::string filename) {
-	std::ifstream input(filename);
+// Rebuild the table of shard with the given capacity (a power of two).
+void Instruction::rehash(Shard& shard, std::size_t capacity) {
+	std::vector<Instruction*> table(capacity, (Instruction*) 0);
 
-	for (std::string line; getline(input, line); ) {
-		std::size_t n = line.find(':');
-		if (n == std::string::npos)
+	std::size_t mask = capacity - 1;
+	for (Instruction* instr : shard.table) {
+		if (!instr)
 			continue;
 
-		Addr addr = std::stoul(line.substr(0, n), 0, 16);
-		if (addr == 0)
-			continue;
+		std::size_t slot = addrHash(instr->m_addr) & mask;
+		while (table[slot])
+			slot = (slot + 1) & mask;
+
+		table[slot] = instr;
+	}
+
+	shard.table.swap(table);
+}
+
+// Parse the address:size:text entries of the instructions map in
+// [begin, end), keeping the offset of each text from base.
+void Instruction::parseEntries(const char* base, const char* begin, const char* end,
+		std::vector<Instruction::Entry>& entries) {
+	const char* ptr = begin;
+	while (ptr < end) {
+		const char* eol = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+		if (!eol)
+			eol = end;
 
-		std::string tmp = line.substr(n+1);
-		if (tmp.empty())
+		const char* line = ptr;
+		ptr = eol + 1;
+
+		while (line < eol && (*line == ' ' || *line == '\t'))
+			line++;
+		if (eol - line > 2 && line[0] == '0' && (line[1] | 0x20) == 'x')
+			line += 2;
+
+		uint64_t addr = 0;
+		const char* sep = scanHex(line, eol, addr);
+		if (sep == line || sep == eol || *sep != ':' || addr == 0)
 			continue;
 
-		n = tmp.find(':');
-		if (n == std::string::npos)
+		uint64_t size = 0;
+		line = sep + 1;
+		sep = scanDecimal(line, eol, size);
+		if (sep == line || sep == eol || *sep != ':' || size == 0)
 			continue;
 
-		int size = std::stoi(tmp);
-		if (size <= 0)
+		const char* text = sep + 1;
+		if (text == eol)
 			continue;
 
-		std::string text = tmp.substr(n+1);
-		if (text.empty())
+		Entry entry = { addr, (int) size, (std::size_t) (text - base),
+				(unsigned) (eol - text) };
+		entries.push_back(entry);
+	}
+}
+
+// Parse the entries in [begin, end) a slice at a time and store them.
+void Instruction::loadChunk(const char* base, const char* begin, const char* end) {
+	std::vector<Entry> entries;
+
+	for (const char* from = begin; from < end; ) {
+		const char* to = from + std::min<std::size_t>(LOAD_SLICE_SIZE, end - from);
+		const char* eol = static_cast<const char*>(std::memchr(to, '\n', end - to));
+		to = eol ? eol + 1 : end;
+
+		Instruction::parseEntries(base, from, to, entries);
+
+		for (const Entry& entry : entries) {
+			Shard& shard = m_shards[shardOf(entry.addr)];
+			std::lock_guard<std::mutex> guard(shard.lock);
+
+			Instruction* instr = Instruction::getLocked(shard, entry.addr, entry.size);
+			instr->m_textOffset = entry.textOffset;
+			instr->m_textLength = entry.textLength;
+		}
+
+		entries.clear();
+		from = to;
+	}
+}
+
+void Instruction::load(const std::string& filename, int jobs) {
+	MappedFile* file = new MappedFile(filename);
+	file->adviseSequential();
+
+	std::vector<char> buffer;
+	const char* begin = file->begin();
+	const char* end = file->end();
+
+	// Compressed maps are decompressed on another thread into memory,
+	// where the texts are kept.
+	if (Decompressor::format(*file) != Decompressor::NONE) {
+		Decompressor decompressor(*file);
+
+		std::size_t size = 0;
+		buffer.resize(file->size() * 4 + 4096);
+		while (true) {
+			if (buffer.size() - size < 4096)
+				buffer.resize(buffer.size() * 2);
+
+			std::size_t n = decompressor.read(&buffer[size], buffer.size() - size);
+			if (n == 0)
+				break;
+
+			size += n;
+		}
+		buffer.resize(size);
+
+		delete file;
+		file = 0;
+
+		begin = buffer.data();
+		end = begin + buffer.size();
+	}
+
+	// Split the map at line ends and parse each chunk on its own thread.
+	std::vector<const char*> bounds;
+	bounds.push_back(begin);
+	for (int i = 1; i < jobs; i++) {
+		const char* from = begin + ((end - begin) / jobs) * i;
+		if (from < bounds.back())
 			continue;
 
-		Instruction* instr = Instruction::get(addr, size);
-		instr->m_text = text;
+		const char* eol = static_cast<const char*>(std::memchr(from, '\n', end - from));
+		if (eol && eol + 1 < end)
+			bounds.push_back(eol + 1);
+	}
+	bounds.push_back(end);
+
+	std::size_t chunks = bounds.size() - 1;
+	std::vector<std::thread> workers;
+	for (std::size_t i = 1; i < chunks; i++) {
+		workers.push_back(std::thread([&bounds, begin, i]() {
+			Instruction::loadChunk(begin, bounds[i], bounds[i+1]);
+		}));
 	}
 
-	input.close();
+	Instruction::loadChunk(begin, bounds[0], bounds[1]);
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	m_mapFile = file;
+	m_mapBuffer.swap(buffer);
+	m_mapText = begin;
 }
 
 void Instruction::clear() {
-	for (std::map<Addr, Instruction*>::iterator it = m_instrsMap.begin(),
-			ed = m_instrsMap.end(); it != ed; it++) {
-		delete it->second;
+	for (Shard& shard : m_shards) {
+		std::lock_guard<std::mutex> guard(shard.lock);
+
+		for (Instruction* instr : shard.table) {
+			if (instr)
+				instr->~Instruction();
+		}
+
+		for (Instruction* slab : shard.slabs)
+			::operator delete(slab);
+
+		std::vector<Instruction*>().swap(shard.table);
+		std::vector<Instruction*>().swap(shard.slabs);
+		shard.used = shard.slabUsed = 0;
+	}
+
+	if (m_mapFile) {
+		delete m_mapFile;
+		m_mapFile = 0;
 	}
+
+	std::vector<char>().swap(m_mapBuffer);
+	m_mapText = 0;
 }
@@ -0,0 +1,82 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <MappedFile.h>
+
+MappedFile::MappedFile(const std::string& filename)
+	: m_filename(filename), m_data(0), m_size(0) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::string("Unable to open file: ") + filename;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		throw std::string("Unable to stat file: ") + filename;
+	}
+
+	m_size = st.st_size;
+	m_mtime = st.st_mtim;
+	if (m_size > 0) {
+		void* ptr = mmap(0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ptr == MAP_FAILED) {
+			close(fd);
+			throw std::string("Unable to map file: ") + filename;
+		}
+
+		m_data = static_cast<char*>(ptr);
+	}
+
+	// The mapping stays valid after the descriptor is closed.
+	close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (m_data)
+		munmap(m_data, m_size);
+}
+
+void MappedFile::adviseSequential() const {
+	if (m_data)
+		madvise(m_data, m_size, MADV_SEQUENTIAL);
+}
+
+void MappedFile::adviseRandom() const {
+	if (m_data)
+		madvise(m_data, m_size, MADV_RANDOM);
+}
+
+// Drop the pages before end from memory, they will not be read again.
+void MappedFile::discard(const char* end) const {
+	std::size_t page = sysconf(_SC_PAGESIZE);
+	std::size_t length = ((end - m_data) / page) * page;
+
+	if (m_data && length > 0)
+		madvise(m_data, length, MADV_DONTNEED);
+}
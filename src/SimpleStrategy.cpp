@@ -26,6 +26,8 @@
 #include <algorithm>
 
 #include <CFGsContainer.h>
+#include <WorkPool.h>
+#include <ReorderBuffer.h>
 #include <SimpleStrategy.h>
 
 SimpleStrategy::SimpleStrategy(const StrategyConfig& config) : Strategy(config) {
@@ -35,92 +37,143 @@ SimpleStrategy::~SimpleStrategy() {
 }
 
 void SimpleStrategy::process() {
-	SimpleStrategy::Report total;
-
 	if (m_fout.is_open())
 		m_fout << "file,cfg,instrs,blocks,phantoms,edges,calls" << std::endl;
 
-	std::set<CFG*> bCFGs = m_b->cfgs();
-	for (CFG* cfg : m_a->cfgs()) {
-		if (cfg->status() != CFG::VALID)
-			continue;
+	if (m_config.stream) {
+		this->processStream();
+	} else {
+		this->processLoaded();
+	}
+
+	if (m_config.follow)
+		this->processFollow();
+
+	this->printTotals();
+}
+
+void SimpleStrategy::printTotals() {
+	if (m_config.detailed)
+		std::cout << "Total:" << std::endl;
+	std::cout << m_total;
+}
+
+void SimpleStrategy::retractPair(Addr addr) {
+	std::map<Addr, Report>::iterator it = m_followed.find(addr);
+	if (it == m_followed.end())
+		return;
+
+	m_total -= it->second;
+	m_followed.erase(it);
+}
+
+void SimpleStrategy::processPair(CFG* a, CFG* b) {
+	SimpleStrategy::Report r = this->comparePair(a, b);
+	m_total += r;
+
+	this->writePair(a, b, r);
+}
+
+// Each worker adds to its own totals, the rows are written in address order.
+void SimpleStrategy::processParallel(const std::vector<Strategy::Pair>& pairs) {
+	WorkPool pool(m_config.jobs);
+	std::vector<Report> totals(pool.workers());
+
+	bool rows = this->writesRows();
+	ReorderBuffer<Report> buffer([this, &pairs](std::size_t i, const Report& r) {
+		this->writePair(pairs[i].a, pairs[i].b, r);
+	});
 
-		Addr addr = cfg->addr();
-		if (!this->isAddrInRange(addr))
-			continue;
+	pool.run(this->largestFirst(pairs), [this, &pairs, &totals, &buffer, rows](int worker,
+			std::size_t i) {
+		SimpleStrategy::Report r = this->comparePair(pairs[i].a, pairs[i].b);
+		totals[worker] += r;
 
-		std::set<CFG*>::iterator it = std::find_if(bCFGs.begin(), bCFGs.end(),
-		             [addr](const CFG* tmp) -> bool { return tmp->addr() == addr; });
-		if (it != bCFGs.end() && (*it)->status() == CFG::VALID) {
-			SimpleStrategy::Report r = compareCFGs(cfg, *it);
-			total.matched += r.matched;
-			total.unmatched.a += r.unmatched.a;
-			total.unmatched.b += r.unmatched.b;
+		if (rows)
+			buffer.put(i, r);
+	});
+
+	for (const Report& total : totals)
+		m_total += total;
+}
+
+// Only CFGs in both files count with -b.
+SimpleStrategy::Report SimpleStrategy::comparePair(CFG* a, CFG* b) {
+	SimpleStrategy::Report r;
+	if (a && b)
+		r = this->compareCFGs(a, b);
+	else if (a && !m_config.both)
+		r.unmatched.a = this->extractStats(a);
+	else if (b && !m_config.both)
+		r.unmatched.b = this->extractStats(b);
+
+	return r;
+}
+
+void SimpleStrategy::writePair(CFG* a, CFG* b, const SimpleStrategy::Report& r) {
+	if (a && b) {
+		Addr addr = a->addr();
+
+		if (m_config.follow)
+			m_followed[addr] = r;
+
+		if (m_config.detailed) {
+			std::cout << std::hex;
+			std::cout << "CFG 0x" << addr << (!m_config.both ? ": both files" : "") << std::endl;
+
+			std::cout << std::dec;
+			std::cout << r;
+			std::cout << std::endl;
+		}
+
+		if (m_fout.is_open()) {
+			m_fout << "both,0x" << std::hex << addr << std::dec
+					<< "," << r.matched.instrs << "," << r.matched.blocks
+					<< "," << r.matched.phantoms << "," << r.matched.edges
+					<< "," << r.matched.calls << std::endl;
+			m_fout << "A,0x" << std::hex << addr << std::dec
+					<< "," << r.unmatched.a.instrs << "," << r.unmatched.a.blocks
+					<< "," << r.unmatched.a.phantoms << "," << r.unmatched.a.edges
+					<< "," << r.unmatched.a.calls << std::endl;
+			m_fout << "B,0x" << std::hex << addr << std::dec
+					<< "," << r.unmatched.b.instrs << "," << r.unmatched.b.blocks
+					<< "," << r.unmatched.b.phantoms << "," << r.unmatched.b.edges
+					<< "," << r.unmatched.b.calls << std::endl;
+		}
+	} else if (a) {
+		if (!m_config.both) {
+			Addr addr = a->addr();
+			const SimpleStrategy::Stats& s = r.unmatched.a;
+
+			if (m_config.follow)
+				m_followed[addr] = r;
 
 			if (m_config.detailed) {
 				std::cout << std::hex;
-				std::cout << "CFG 0x" << addr << (!m_config.both ? ": both files" : "") << std::endl;
+				std::cout << "CFG 0x" << addr << ": file A" << std::endl;
 
 				std::cout << std::dec;
-				std::cout << r;
+				std::cout << s << std::endl;
 				std::cout << std::endl;
 			}
 
 			if (m_fout.is_open()) {
-				m_fout << "both,0x" << std::hex << addr << std::dec
-						<< "," << r.matched.instrs << "," << r.matched.blocks
-						<< "," << r.matched.phantoms << "," << r.matched.edges
-						<< "," << r.matched.calls << std::endl;
 				m_fout << "A,0x" << std::hex << addr << std::dec
-						<< "," << r.unmatched.a.instrs << "," << r.unmatched.a.blocks
-						<< "," << r.unmatched.a.phantoms << "," << r.unmatched.a.edges
-						<< "," << r.unmatched.a.calls << std::endl;
-				m_fout << "B,0x" << std::hex << addr << std::dec
-						<< "," << r.unmatched.b.instrs << "," << r.unmatched.b.blocks
-						<< "," << r.unmatched.b.phantoms << "," << r.unmatched.b.edges
-						<< "," << r.unmatched.b.calls << std::endl;
-			}
-
-			bCFGs.erase(it);
-		} else {
-			if (!m_config.both) {
-				SimpleStrategy::Stats s = extractStats(cfg);
-				total.unmatched.a += s;
-
-				if (m_config.detailed) {
-					std::cout << std::hex;
-					std::cout << "CFG 0x" << addr << ": file A" << std::endl;
-
-					std::cout << std::dec;
-					std::cout << s << std::endl;
-					std::cout << std::endl;
-				}
-
-				if (m_fout.is_open()) {
-					m_fout << "A,0x" << std::hex << addr << std::dec
-							<< "," << s.instrs << "," << s.blocks
-							<< "," << s.phantoms << "," << s.edges
-							<< "," << s.calls << std::endl;
-				}
+						<< "," << s.instrs << "," << s.blocks
+						<< "," << s.phantoms << "," << s.edges
+						<< "," << s.calls << std::endl;
 			}
 		}
-	}
-
-	if (!m_config.both) {
-		for (CFG* cfg : bCFGs) {
-			if (cfg->status() != CFG::VALID)
-				continue;
+	} else if (b) {
+		if (!m_config.both) {
+			const SimpleStrategy::Stats& s = r.unmatched.b;
 
-			Addr addr = cfg->addr();
-			if (!this->isAddrInRange(addr))
-				continue;
-
-			SimpleStrategy::Stats s = extractStats(cfg);
-			total.unmatched.b += s;
+			if (m_config.follow)
+				m_followed[b->addr()] = r;
 
 			if (m_config.detailed) {
 				std::cout << std::hex;
-				std::cout << "CFG 0x" << cfg->addr() << ": file B" << std::endl;
+				std::cout << "CFG 0x" << b->addr() << ": file B" << std::endl;
 
 				std::cout << std::dec;
 				std::cout << s << std::endl;
@@ -128,93 +181,40 @@ void SimpleStrategy::process() {
 			}
 
 			if (m_fout.is_open()) {
-				m_fout << "B,0x" << std::hex << cfg->addr() << std::dec
+				m_fout << "B,0x" << std::hex << b->addr() << std::dec
 						<< "," << s.instrs << "," << s.blocks
 						<< "," << s.phantoms << "," << s.edges
 						<< "," << s.calls << std::endl;
 			}
 		}
 	}
-
-	if (m_config.detailed)
-		std::cout << "Total:" << std::endl;
-	std::cout << total;
 }
 
+// Count the items in both a and b, walking them in order like a merge.
 template<typename T>
-std::set<T> SimpleStrategy::matchGeneric(std::set<T>& a, std::set<T>& b) {
-	std::set<T> match;
-
-	typename std::set<T>::iterator itA = a.begin();
-	while (itA != a.end()) {
-		const T& v = *itA;
-
-		typename std::set<T>::iterator itB = b.find(v);
-		if (itB != b.end()) {
-			b.erase(itB);
+int SimpleStrategy::matchGeneric(const std::vector<T>& a, const std::vector<T>& b) {
+	int match = 0;
 
-			match.insert(v);
-			itA = a.erase(itA);
-		} else {
+	typename std::vector<T>::const_iterator itA = a.begin(), itB = b.begin();
+	while (itA != a.end() && itB != b.end()) {
+		if (*itA < *itB) {
 			itA++;
-		}
-	}
-
-	return match;
-}
-
-std::set<CfgData::Call> SimpleStrategy::matchCalls(std::set<CfgData::Call>& a, std::set<CfgData::Call>& b) {
-	std::set<CfgData::Call> match;
-
-	std::set<CfgData::Call>::iterator itA = a.begin();
-	while (itA != a.end()) {
-		CfgData::Call callA = *itA;
-
-		std::set<CfgData::Call>::iterator itB = b.find(callA);
-		if (itB != b.end()) {
-			CfgData::Call callB = *itB;
-
-			// Always remove, it may be added again later.
-			itA = a.erase(itA);
-			itB = b.erase(itB);
-
-			CfgData::Call newCall(callA.block_addr);
-
-			std::set<Addr>::iterator it2A = callA.calls.begin();
-			while (it2A != callA.calls.end()) {
-				std::set<Addr>::iterator it2B = callB.calls.find(*it2A);
-				if (it2B != callB.calls.end()) {
-					callB.calls.erase(it2B);
-
-					newCall.calls.insert(*it2A);
-					it2A = callA.calls.erase(it2A);
-				} else {
-					it2A++;
-				}
-			}
-
-			if (newCall.calls.size() > 0)
-				match.insert(newCall);
-
-			// If it still has at least one call, add it back.
-			if (!callA.calls.empty())
-				a.insert(callA);
-			if (!callB.calls.empty())
-				b.insert(callB);
+		} else if (*itB < *itA) {
+			itB++;
 		} else {
+			match++;
 			itA++;
+			itB++;
 		}
 	}
 
 	return match;
 }
 
-int SimpleStrategy::countCalls(const std::set<CfgData::Call>& calls) {
-	int total = 0;
-	for (CfgData::Call c : calls)
-		total += c.calls.size();
-
-	return total;
+template<typename Near, typename Far>
+int SimpleStrategy::matchGeneric(const CfgData::Items<Near, Far>& a,
+		const CfgData::Items<Near, Far>& b) {
+	return this->matchGeneric(a.near, b.near) + this->matchGeneric(a.far, b.far);
 }
 
 SimpleStrategy::Stats SimpleStrategy::extractStats(CFG* cfg) {
@@ -226,7 +226,7 @@ SimpleStrategy::Stats SimpleStrategy::extractStats(CFG* cfg) {
 	s.blocks = data.blocks().size();
 	s.phantoms = data.phantoms().size();
 	s.edges = data.edges().size();
-	s.calls = countCalls(data.calls());
+	s.calls = data.calls().size();
 
 	return s;
 }
@@ -241,40 +241,26 @@ SimpleStrategy::Report SimpleStrategy::compareCFGs(CFG* a, CFG* b) {
 	r.unmatched.a.cfgs = 0;
 	r.unmatched.b.cfgs = 0;
 
-	std::set<Addr> instrsA = dataA.instrs();
-	std::set<Addr> instrsB = dataB.instrs();
-	std::set<Addr> instrsAB = matchGeneric(instrsA, instrsB);
-	r.matched.instrs = instrsAB.size();
-	r.unmatched.a.instrs = instrsA.size();
-	r.unmatched.b.instrs = instrsB.size();
-
-	std::set<CfgData::Node> blocksA = dataA.blocks();
-	std::set<CfgData::Node> blocksB = dataB.blocks();
-	std::set<CfgData::Node> blocksAB = matchGeneric(blocksA, blocksB);
-	r.matched.blocks = blocksAB.size();
-	r.unmatched.a.blocks = blocksA.size();
-	r.unmatched.b.blocks = blocksB.size();
-
-	std::set<Addr> phantomsA = dataA.phantoms();
-	std::set<Addr> phantomsB = dataB.phantoms();
-	std::set<Addr> phantomsAB = matchGeneric(phantomsA, phantomsB);
-	r.matched.phantoms = phantomsAB.size();
-	r.unmatched.a.phantoms = phantomsA.size();
-	r.unmatched.b.phantoms = phantomsB.size();
-
-	std::set<CfgData::Edge> edgesA = dataA.edges();
-	std::set<CfgData::Edge> edgesB = dataB.edges();
-	std::set<CfgData::Edge> edgesAB = matchGeneric(edgesA, edgesB);
-	r.matched.edges = edgesAB.size();
-	r.unmatched.a.edges = edgesA.size();
-	r.unmatched.b.edges = edgesB.size();
-
-	std::set<CfgData::Call> callsA = dataA.calls();
-	std::set<CfgData::Call> callsB = dataB.calls();
-	std::set<CfgData::Call> callsAB = matchCalls(callsA, callsB);
-	r.matched.calls = countCalls(callsAB);
-	r.unmatched.a.calls = countCalls(callsA);
-	r.unmatched.b.calls = countCalls(callsB);
+	r.matched.instrs = matchGeneric(dataA.instrs(), dataB.instrs());
+	r.unmatched.a.instrs = dataA.instrs().size() - r.matched.instrs;
+	r.unmatched.b.instrs = dataB.instrs().size() - r.matched.instrs;
+
+	r.matched.blocks = matchGeneric(dataA.blocks(), dataB.blocks());
+	r.unmatched.a.blocks = dataA.blocks().size() - r.matched.blocks;
+	r.unmatched.b.blocks = dataB.blocks().size() - r.matched.blocks;
+
+	r.matched.phantoms = matchGeneric(dataA.phantoms(), dataB.phantoms());
+	r.unmatched.a.phantoms = dataA.phantoms().size() - r.matched.phantoms;
+	r.unmatched.b.phantoms = dataB.phantoms().size() - r.matched.phantoms;
+
+	r.matched.edges = matchGeneric(dataA.edges(), dataB.edges());
+	r.unmatched.a.edges = dataA.edges().size() - r.matched.edges;
+	r.unmatched.b.edges = dataB.edges().size() - r.matched.edges;
+
+	// Calls are matched one called CFG at a time.
+	r.matched.calls = matchGeneric(dataA.calls(), dataB.calls());
+	r.unmatched.a.calls = dataA.calls().size() - r.matched.calls;
+	r.unmatched.b.calls = dataB.calls().size() - r.matched.calls;
 
 	return r;
 }
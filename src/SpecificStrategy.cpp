@@ -24,10 +24,13 @@
 
 #include <map>
 #include <cassert>
+#include <algorithm>
 #include <iostream>
 
 #include <CFG.h>
 #include <CFGsContainer.h>
+#include <WorkPool.h>
+#include <ReorderBuffer.h>
 #include <SpecificStrategy.h>
 
 SpecificStrategy::SpecificStrategy(const StrategyConfig& config) : Strategy(config) {
@@ -37,10 +40,6 @@ SpecificStrategy::~SpecificStrategy() {
 }
 
 void SpecificStrategy::process() {
-	struct {
-		SpecificStrategy::Stats present, missing;
-	} total;
-
 	if (m_fout.is_open())
 		m_fout << "cfg,type,instrs,blocks_perfect,blocks_conflict,"
 		       << "phantoms,"
@@ -48,96 +47,185 @@ void SpecificStrategy::process() {
 			   << "edges_external_perfect,edges_external_conflict,"
 			   << "calls,indirect" << std::endl;
 
-	int cfgs = 0;
-	for (CFG* aCFG : m_a->cfgs()) {
-		if (aCFG->status() != CFG::VALID)
-			continue;
+	if (m_config.stream) {
+		this->processStream();
+	} else {
+		this->processLoaded();
+	}
 
-		Addr addr = aCFG->addr();
-		if (!this->isAddrInRange(addr))
-			continue;
+	if (m_config.follow)
+		this->processFollow();
 
-		CFG* bCFG = m_b->cfg(addr);
-		if (bCFG == 0 || bCFG->status() != CFG::VALID)
-			continue;
+	this->printTotals();
+}
 
-		SpecificStrategy::Report report = compareCFGs(aCFG, bCFG);
+void SpecificStrategy::printTotals() {
+	if (m_config.detailed)
+		std::cout << "Total: " << std::endl;
+	std::cout << "present: cfgs(" << m_total.cfgs << "), " << m_total.present << std::endl;
+	std::cout << "missing: cfgs(0), " << m_total.missing << std::endl;
+}
 
-		SpecificStrategy::Stats aStats = this->extractStats(report.present);
-		SpecificStrategy::Stats bStats = this->extractStats(report.missing);
+void SpecificStrategy::retractPair(Addr addr) {
+	std::map<Addr, Report>::iterator it = m_followed.find(addr);
+	if (it == m_followed.end())
+		return;
 
-		if (m_config.detailed) {
-			std::cout << std::hex;
-			std::cout << "CFG 0x" << aCFG->addr() << std::endl;
-			std::cout << std::dec;
-			std::cout << "present: " << aStats << std::endl;
-			std::cout << "missing: " << bStats << std::endl;
-			std::cout << std::endl;
-		}
+	m_total -= it->second;
+	m_followed.erase(it);
+}
 
-		if (m_fout.is_open()) {
-			m_fout << "0x" << std::hex << aCFG->addr() << std::dec
-					<< ",present," << aStats.instrs << ","
-					<< aStats.blocks.perfect << "," << aStats.blocks.conflict << ","
-					<< aStats.phantoms << ","
-					<< aStats.edges.internal.perfect << "," << aStats.edges.internal.conflict << ","
-					<< aStats.edges.external.perfect << "," << aStats.edges.external.conflict << ","
-					<< aStats.calls << "," << aStats.indirects << std::endl;
-
-			m_fout << "0x" << std::hex << bCFG->addr() << std::dec
-					<< ",missing," << bStats.instrs << ","
-					<< bStats.blocks.perfect << "," << bStats.blocks.conflict << ","
-					<< bStats.phantoms << ","
-					<< bStats.edges.internal.perfect << "," << bStats.edges.internal.conflict << ","
-					<< bStats.edges.external.perfect << "," << bStats.edges.external.conflict << ","
-					<< bStats.calls << "," << bStats.indirects << std::endl;
-		}
+void SpecificStrategy::processPair(CFG* aCFG, CFG* bCFG) {
+	// Only CFGs in both files are compared.
+	if (aCFG == 0 || bCFG == 0)
+		return;
 
-		total.present += aStats;
-		total.missing += bStats;
+	SpecificStrategy::Report report = compareCFGs(aCFG, bCFG);
+	m_total += report;
 
-		cfgs++;
+	this->writePair(aCFG, bCFG, report);
+}
+
+// Each worker adds to its own totals, the rows are written in address order.
+void SpecificStrategy::processParallel(const std::vector<Strategy::Pair>& pairs) {
+	std::vector<Strategy::Pair> both;
+	for (const Strategy::Pair& pair : pairs) {
+		if (pair.a && pair.b)
+			both.push_back(pair);
 	}
 
-	if (m_config.detailed)
-		std::cout << "Total: " << std::endl;
-	std::cout << "present: cfgs(" << cfgs << "), " << total.present << std::endl;
-	std::cout << "missing: cfgs(0), " << total.missing << std::endl;
+	WorkPool pool(m_config.jobs);
+	std::vector<Report> totals(pool.workers());
+
+	bool rows = this->writesRows();
+	ReorderBuffer<Report> buffer([this, &both](std::size_t i, const Report& report) {
+		this->writePair(both[i].a, both[i].b, report);
+	});
+
+	pool.run(this->largestFirst(both), [this, &both, &totals, &buffer, rows](int worker,
+			std::size_t i) {
+		SpecificStrategy::Report report = this->compareCFGs(both[i].a, both[i].b);
+		totals[worker] += report;
+
+		if (rows)
+			buffer.put(i, report);
+	});
+
+	for (const Report& total : totals)
+		m_total += total;
+}
+
+void SpecificStrategy::writePair(CFG* aCFG, CFG* bCFG, const SpecificStrategy::Report& report) {
+	const SpecificStrategy::Stats& aStats = report.present;
+	const SpecificStrategy::Stats& bStats = report.missing;
+
+	if (m_config.detailed) {
+		std::cout << std::hex;
+		std::cout << "CFG 0x" << aCFG->addr() << std::endl;
+		std::cout << std::dec;
+		std::cout << "present: " << aStats << std::endl;
+		std::cout << "missing: " << bStats << std::endl;
+		std::cout << std::endl;
+	}
+
+	if (m_fout.is_open()) {
+		m_fout << "0x" << std::hex << aCFG->addr() << std::dec
+				<< ",present," << aStats.instrs << ","
+				<< aStats.blocks.perfect << "," << aStats.blocks.conflict << ","
+				<< aStats.phantoms << ","
+				<< aStats.edges.internal.perfect << "," << aStats.edges.internal.conflict << ","
+				<< aStats.edges.external.perfect << "," << aStats.edges.external.conflict << ","
+				<< aStats.calls << "," << aStats.indirects << std::endl;
+
+		m_fout << "0x" << std::hex << bCFG->addr() << std::dec
+				<< ",missing," << bStats.instrs << ","
+				<< bStats.blocks.perfect << "," << bStats.blocks.conflict << ","
+				<< bStats.phantoms << ","
+				<< bStats.edges.internal.perfect << "," << bStats.edges.internal.conflict << ","
+				<< bStats.edges.external.perfect << "," << bStats.edges.external.conflict << ","
+				<< bStats.calls << "," << bStats.indirects << std::endl;
+	}
+
+	if (m_config.follow)
+		m_followed[aCFG->addr()] = report;
+}
+
+// Position of item in the sorted items, or their size if it is not there.
+template<typename T>
+static std::size_t findSorted(const std::vector<T>& items, const T& item) {
+	typename std::vector<T>::const_iterator it =
+			std::lower_bound(items.begin(), items.end(), item);
+	return (it != items.end() && *it == item) ? it - items.begin() : items.size();
 }
 
-void SpecificStrategy::matchAddresses(std::set<Addr>& aInstrs, std::set<Addr>& bInstrs) {
-	for (std::set<Addr>::iterator bIT = bInstrs.begin(),
-			bED = bInstrs.end(); bIT != bED; ) {
-		std::set<Addr>::iterator aIT = aInstrs.find(*bIT),
-				aED = aInstrs.end();
-		if (aIT != aED) {
-			bIT = bInstrs.erase(bIT);
+// Count the items of b that are not in a, walking both in order.
+template<typename T>
+int SpecificStrategy::matchGeneric(const std::vector<T>& a, const std::vector<T>& b) {
+	int missing = 0;
+
+	typename std::vector<T>::const_iterator aIT = a.begin(), bIT = b.begin();
+	while (bIT != b.end()) {
+		if (aIT == a.end() || *bIT < *aIT) {
+			missing++;
+			bIT++;
+		} else if (*aIT < *bIT) {
+			aIT++;
 		} else {
+			aIT++;
 			bIT++;
 		}
 	}
+
+	return missing;
+}
+
+template<typename Near, typename Far>
+int SpecificStrategy::matchGeneric(const CfgData::Items<Near, Far>& a,
+		const CfgData::Items<Near, Far>& b) {
+	return this->matchGeneric(a.near, b.near) + this->matchGeneric(a.far, b.far);
 }
 
-void SpecificStrategy::matchBlocks(SpecificStrategy::Info::Block& aBlocks,
-		SpecificStrategy::Info::Block& bBlocks) {
-	for (std::set<CfgData::Node>::iterator bIT = bBlocks.perfect.begin(),
-			bED = bBlocks.perfect.end(); bIT != bED; ) {
+// Each block of b matches the first block of a, in address order, that is
+// either equal to it or overlaps it. Overlapping blocks are both conflicts
+// and the block of a is not matched again.
+template<typename T>
+void SpecificStrategy::matchBlocks(const std::vector<T>& aBlocks,
+		const std::vector<T>& bBlocks, SpecificStrategy::Report& report) {
+	typedef typename T::Position Position;
+
+	std::vector<bool> aConflicts(aBlocks.size(), false);
+
+	// No block of a that starts more than the largest size before a block
+	// of b reaches it.
+	int largest = 0;
+	for (const T& aNode : aBlocks)
+		largest = std::max(largest, (int) aNode.size);
+
+	int perfect = 0, conflict = 0;
+	for (const T& bNode : bBlocks) {
+		Position bStart = bNode.start;
+		Position bEnd = bNode.end();
+
+		typename std::vector<T>::const_iterator aIT = std::lower_bound(aBlocks.begin(),
+				aBlocks.end(), bStart, [largest](const T& aNode, Position start) {
+			return (Position) aNode.start + largest < start;
+		});
+
 		bool next = true;
-		for (std::set<CfgData::Node>::iterator aIT = aBlocks.perfect.begin(),
-				aED = aBlocks.perfect.end(); aIT != aED; aIT++) {
-			const CfgData::Node& aNode = *aIT;
-			const CfgData::Node& bNode = *bIT;
+		for (typename std::vector<T>::const_iterator aED = aBlocks.end(); aIT != aED; aIT++) {
+			const T& aNode = *aIT;
+			if ((Position) aNode.start > bEnd)
+				break;
+
+			if (aConflicts[aIT - aBlocks.begin()])
+				continue;
+
 			if (aNode == bNode) {
-				bIT = bBlocks.perfect.erase(bIT);
 				next = false;
 				break;
-			} else if (aNode.start < (bNode.start + bNode.size) &&
-					   bNode.start < (aNode.start + aNode.size)) {
-				aBlocks.conflict.insert(aNode);
-				aBlocks.perfect.erase(aIT);
-
-				bBlocks.conflict.insert(bNode);
-				bIT = bBlocks.perfect.erase(bIT);
+			} else if ((Position) aNode.start < bEnd && bStart < aNode.end()) {
+				aConflicts[aIT - aBlocks.begin()] = true;
+				conflict++;
 
 				next = false;
 				break;
@@ -145,156 +233,145 @@ void SpecificStrategy::matchBlocks(SpecificStrategy::Info::Block& aBlocks,
 		}
 
 		if (next)
-			bIT++;
+			perfect++;
 	}
+
+	report.present.blocks.perfect += aBlocks.size() - conflict;
+	report.present.blocks.conflict += conflict;
+	report.missing.blocks.perfect += perfect;
+	report.missing.blocks.conflict += conflict;
 }
 
-void SpecificStrategy::matchEdges(SpecificStrategy::Info::Edge& aEdges,
-		SpecificStrategy::Info::Edge& bEdges) {
-	for (std::set<CfgData::Edge>::iterator bIT = bEdges.internal.perfect.begin(),
-			bED = bEdges.internal.perfect.end(); bIT != bED; ) {
-		std::set<CfgData::Edge>::iterator aIT = aEdges.internal.perfect.find(*bIT),
-				aED = aEdges.internal.perfect.end();
-		if (aIT != aED) {
-			bIT = bEdges.internal.perfect.erase(bIT);
-			continue;
-		}
+static std::vector<CfgData::Node> wideBlocks(Addr base, const CfgData::Nodes& blocks) {
+	std::vector<CfgData::Node> wide(blocks.far.begin(), blocks.far.end());
+	for (const CfgData::NearNode& node : blocks.near)
+		wide.push_back(CfgData::Node(RelAddr::decode(base, node.start), node.size));
 
-		aIT = aEdges.external.perfect.find(*bIT),
-				aED = aEdges.external.perfect.end();
-		if (aIT != aED) {
-			aEdges.external.conflict.insert(*aIT);
-			aEdges.external.perfect.erase(aIT);
+	std::sort(wide.begin(), wide.end());
+	return wide;
+}
+
+// Blocks may overlap across the near and far parts, so CFGs with far
+// blocks are matched on full addresses.
+void SpecificStrategy::matchBlocks(Addr base, const CfgData::Nodes& aBlocks,
+		const CfgData::Nodes& bBlocks, SpecificStrategy::Report& report) {
+	if (aBlocks.far.empty() && bBlocks.far.empty())
+		this->matchBlocks(aBlocks.near, bBlocks.near, report);
+	else
+		this->matchBlocks(wideBlocks(base, aBlocks), wideBlocks(base, bBlocks), report);
+}
+
+// An internal edge of b matches the same internal edge of a, or else
+// conflicts with the same external edge of a. External edges of b are
+// matched the other way around.
+template<typename T>
+void SpecificStrategy::matchEdges(const std::vector<T>& aInternal,
+		const std::vector<T>& aExternal, const std::vector<T>& bInternal,
+		const std::vector<T>& bExternal, SpecificStrategy::Report& report) {
+	std::vector<bool> aInternalConflicts(aInternal.size(), false);
+	std::vector<bool> aExternalConflicts(aExternal.size(), false);
+
+	int internalPerfect = 0, internalConflict = 0;
+	for (const T& bEdge : bInternal) {
+		if (findSorted(aInternal, bEdge) != aInternal.size())
+			continue;
 
-			bEdges.internal.conflict.insert(*bIT);
-			bIT = bEdges.internal.perfect.erase(bIT);
+		std::size_t pos = findSorted(aExternal, bEdge);
+		if (pos != aExternal.size() && !aExternalConflicts[pos]) {
+			aExternalConflicts[pos] = true;
+			internalConflict++;
 			continue;
 		}
 
-		bIT++;
+		internalPerfect++;
 	}
 
-	for (std::set<CfgData::Edge>::iterator bIT = bEdges.external.perfect.begin(),
-			bED = bEdges.external.perfect.end(); bIT != bED; ) {
-		std::set<CfgData::Edge>::iterator aIT = aEdges.external.perfect.find(*bIT),
-				aED = aEdges.external.perfect.end();
-		if (aIT != aED) {
-			bIT = bEdges.external.perfect.erase(bIT);
+	int externalPerfect = 0, externalConflict = 0;
+	for (const T& bEdge : bExternal) {
+		std::size_t pos = findSorted(aExternal, bEdge);
+		if (pos != aExternal.size() && !aExternalConflicts[pos])
 			continue;
-		}
-
-		aIT = aEdges.internal.perfect.find(*bIT),
-				aED = aEdges.internal.perfect.end();
-		if (aIT != aED) {
-			aEdges.internal.conflict.insert(*aIT);
-			aEdges.internal.perfect.erase(aIT);
 
-			bEdges.external.conflict.insert(*bIT);
-			bIT = bEdges.external.perfect.erase(bIT);
+		pos = findSorted(aInternal, bEdge);
+		if (pos != aInternal.size() && !aInternalConflicts[pos]) {
+			aInternalConflicts[pos] = true;
+			externalConflict++;
 			continue;
 		}
 
-		bIT++;
+		externalPerfect++;
 	}
-}
 
-void SpecificStrategy::matchCalls(std::set<CfgData::Call>& aCalls,
-		std::set<CfgData::Call>& bCalls) {
-	std::list<CfgData::Call> newCalls;
-
-	for (std::set<CfgData::Call>::iterator bIT = bCalls.begin(),
-			bED = bCalls.end(); bIT != bED; ) {
-		std::set<CfgData::Call>::iterator aIT = aCalls.find(*bIT),
-				aED = aCalls.end();
-		if (aIT != aED) {
-			CfgData::Call nCall = *bIT;
-			bIT = bCalls.erase(bIT);
-
-			for (std::set<Addr>::iterator bAddrIT = nCall.calls.begin(),
-					bAddrED = nCall.calls.end(); bAddrIT != bAddrED; ) {
-				std::set<Addr>::iterator aAddrIT = (*aIT).calls.find(*bAddrIT),
-									aAddrED = (*aIT).calls.end();
-				if (aAddrIT != aAddrED) {
-					bAddrIT = nCall.calls.erase(bAddrIT);
-				} else {
-					bAddrIT++;
-				}
-			}
+	report.present.edges.internal.perfect += aInternal.size() - externalConflict;
+	report.present.edges.internal.conflict += externalConflict;
+	report.present.edges.external.perfect += aExternal.size() - internalConflict;
+	report.present.edges.external.conflict += internalConflict;
 
-			if (nCall.calls.size() > 0)
-				newCalls.push_back(nCall);
-		} else {
-			bIT++;
-		}
-	}
+	report.missing.edges.internal.perfect += internalPerfect;
+	report.missing.edges.internal.conflict += internalConflict;
+	report.missing.edges.external.perfect += externalPerfect;
+	report.missing.edges.external.conflict += externalConflict;
+}
 
-	bCalls.insert(newCalls.begin(), newCalls.end());
+// An edge is near or far the same way in a and b, so both parts are
+// matched on their own.
+void SpecificStrategy::matchEdges(const SpecificStrategy::Info& a,
+		const SpecificStrategy::Info& b, SpecificStrategy::Report& report) {
+	this->matchEdges(a.internal.near, a.data.edges().near,
+		b.internal.near, b.data.edges().near, report);
+	this->matchEdges(a.internal.far, a.data.edges().far,
+		b.internal.far, b.data.edges().far, report);
 }
 
+// What a has is present, what only b has is missing.
 SpecificStrategy::Report SpecificStrategy::compareCFGs(CFG* a, CFG* b) {
-	SpecificStrategy::Report r = { .present = this->extractInfo(a),
-			.missing = this->extractInfo(b) };
+	SpecificStrategy::Info aInfo(a), bInfo(b);
+	this->extractInfo(a, aInfo);
+	this->extractInfo(b, bInfo);
 
-	this->matchAddresses(r.present.instrs, r.missing.instrs);
-	this->matchBlocks(r.present.blocks, r.missing.blocks);
-	this->matchAddresses(r.present.phantoms, r.missing.phantoms);
-	this->matchEdges(r.present.edges, r.missing.edges);
-	this->matchCalls(r.present.calls, r.missing.calls);
-	this->matchAddresses(r.present.indirects, r.missing.indirects);
+	const CfgData& aData = aInfo.data;
+	const CfgData& bData = bInfo.data;
 
-	return r;
-}
+	SpecificStrategy::Report r;
+	r.cfgs = 1;
+	r.present.instrs = aData.instrs().size();
+	r.missing.instrs = this->matchGeneric(aData.instrs(), bData.instrs());
 
-SpecificStrategy::Info SpecificStrategy::extractInfo(CFG* cfg) {
-	SpecificStrategy::Info info;
+	this->matchBlocks(aData.base(), aData.blocks(), bData.blocks(), r);
 
-	CfgData data(cfg);
-	info.instrs = data.instrs();
-	info.blocks.perfect = data.blocks();
-	info.phantoms = data.phantoms();
-	info.edges.external.perfect = data.edges();
-	info.calls = data.calls();
-	info.indirects = data.indirects();
+	r.present.phantoms = aData.phantoms().size();
+	r.missing.phantoms = this->matchGeneric(aData.phantoms(), bData.phantoms());
 
-	for (CfgNode* node : cfg->nodes()) {
-		if (node->type() != CfgNode::CFG_BLOCK)
-			continue;
+	this->matchEdges(aInfo, bInfo, r);
 
-		CfgNode::BlockData* block = static_cast<CfgNode::BlockData*>(node->data());
-		Instruction* previous = 0;
-		for (Instruction* instr : block->instructions()) {
-			if (previous != 0)
-				info.edges.internal.perfect.insert(CfgData::Edge(previous->addr(), instr->addr()));
+	// Calls are matched one called CFG at a time.
+	r.present.calls = aData.calls().size();
+	r.missing.calls = this->matchGeneric(aData.calls(), bData.calls());
 
-			previous = instr;
-		}
-	}
+	r.present.indirects = aData.indirects().size();
+	r.missing.indirects = this->matchGeneric(aData.indirects(), bData.indirects());
 
-	return info;
+	return r;
 }
 
-SpecificStrategy::Stats SpecificStrategy::extractStats(const SpecificStrategy::Info& info) {
-	Stats s;
-
-	s.instrs = info.instrs.size();
-
-	s.blocks.perfect = info.blocks.perfect.size();
-	s.blocks.conflict = info.blocks.conflict.size();
-
-	s.phantoms += info.phantoms.size();
+void SpecificStrategy::extractInfo(CFG* cfg, SpecificStrategy::Info& info) {
+	const CfgGraph& graph = cfg->graph();
+	info.internal.near.reserve(graph.countInstructions());
 
-	s.edges.internal.perfect = info.edges.internal.perfect.size();
-	s.edges.internal.conflict = info.edges.internal.conflict.size();
-	s.edges.external.perfect = info.edges.external.perfect.size();
-	s.edges.external.conflict = info.edges.external.conflict.size();
-
-	s.calls = 0;
-	for (CfgData::Call call : info.calls)
-		s.calls += call.calls.size();
+	for (CfgGraph::Index node = 0, count = graph.size(); node < count; node++) {
+		if (graph.type(node) != CfgNode::CFG_BLOCK)
+			continue;
 
-	s.indirects += info.indirects.size();
+		// Every instruction but the last falls through to the next one.
+		Addr end = graph.addr(node) + graph.blockSize(node);
+		for (InstrRun::Entry instr : graph.instructions(node)) {
+			Addr next = instr.addr + instr.size;
+			if (next != end)
+				CfgData::add(info.internal, cfg->addr(), CfgData::Edge(instr.addr, next));
+		}
+	}
 
-	return s;
+	CfgData::sortUnique(info.internal);
 }
 
 std::ostream& operator<<(std::ostream& os, const SpecificStrategy::Stats& stats) {
@@ -22,28 +22,105 @@
    The GNU General Public License is contained in the file COPYING.
 */
 
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
 #include <Strategy.h>
 #include <Instruction.h>
 #include <CFGsContainer.h>
+#include <CfgsIndex.h>
 
-Strategy::Strategy(const StrategyConfig& config) : m_config(config), m_a(0), m_b(0) {
-	if (config.instrs)
-		Instruction::load(std::string(config.instrs));
+static void printLoadStats(const char* name, const CFGsContainer* container) {
+	double mb = container->inputSize() / (1024.0 * 1024.0);
+	double secs = container->loadTime();
 
-	m_a = new CFGsContainer((std::string(config.input1)), "A");
-	m_b = new CFGsContainer((std::string(config.input2)), "B");
+	std::cerr << "Loaded " << name << ": " << mb << " MB in "
+		<< secs << " s (" << (secs > 0 ? mb / secs : 0) << " MB/s)" << std::endl;
+}
 
-	if (config.compress) {
-		m_a->compressAll();
-		m_b->compressAll();
+// With -b, only the CFGs present in the other input are compared. Restrict
+// filter to them when the other input has an up to date index.
+static void restrictToIndexed(AddrFilter& filter, const char* other) {
+	CfgsIndex* index = CfgsIndex::open(std::string(other));
+	if (index) {
+		filter.restrictTo(index->addresses());
+		delete index;
 	}
+}
+
+// Load one input and prepare it for the comparison. Each input runs this
+// on its own thread. Dumps include the instruction texts, so they wait for
+// the instructions map.
+static CFGsContainer* loadInput(const StrategyConfig& config, const char* filename,
+		const char* name, const CFGsContainer::Options& options,
+		std::shared_future<void> instrs) {
+	CFGsContainer* container = new CFGsContainer(std::string(filename), name, options);
+
+	// Streamed CFGs are prepared one at a time, see nextStreamed().
+	if (config.stream)
+		return container;
 
-	m_a->checkAll();
-	m_b->checkAll();
+	if (config.compress)
+		container->compressAll();
+
+	container->checkAll();
 
 	if (config.dump) {
-		m_a->dumpAll(config.dump);
-		m_b->dumpAll(config.dump);
+		instrs.get();
+		container->dumpAll(config.dump);
+	}
+
+	return container;
+}
+
+Strategy::Strategy(const StrategyConfig& config) : m_config(config),
+		m_filter(config.ranges), m_a(0), m_b(0) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Dumps cover every CFG, so only load selectively without them.
+	CFGsContainer::Options optionsA(config.jobs, config.cache, config.index, config.stream);
+	CFGsContainer::Options optionsB(config.jobs, config.cache, config.index, config.stream,
+		config.follow);
+	if (!config.dump) {
+		optionsA.filter = optionsB.filter = m_filter;
+
+		// A followed input will have CFGs its index does not know of.
+		if (config.both) {
+			if (!config.follow)
+				restrictToIndexed(optionsA.filter, config.input2);
+			restrictToIndexed(optionsB.filter, config.input1);
+		}
+	}
+
+	// The instructions map, A and B are loaded at the same time.
+	std::shared_future<void> instrs = std::async(std::launch::async, [&config]() {
+		if (config.instrs)
+			Instruction::load(std::string(config.instrs), config.jobs);
+	}).share();
+
+	std::future<CFGsContainer*> a = std::async(std::launch::async, loadInput,
+		std::cref(config), config.input1, "A", std::cref(optionsA), instrs);
+	std::future<CFGsContainer*> b = std::async(std::launch::async, loadInput,
+		std::cref(config), config.input2, "B", std::cref(optionsB), instrs);
+
+	m_a = a.get();
+	m_b = b.get();
+	instrs.get();
+
+	if (config.verbose && !config.stream) {
+		printLoadStats("A", m_a);
+		printLoadStats("B", m_b);
+
+		std::cerr << "Ready in " << std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
 	}
 
 	if (config.output) {
@@ -63,20 +140,208 @@ Strategy::~Strategy() {
 	if (m_b)
 		delete m_b;
 
-	if (m_config.instrs)
-		Instruction::clear();
+	// Debug builds also keep the instructions of A and B, see
+	// CfgNode::BlockData::addInstruction().
+	Instruction::clear();
 }
 
 bool Strategy::isAddrInRange(Addr addr) const {
 	// if the range list is empty, consider the address in range.
-	if (m_config.ranges.size() == 0)
-		return true;
+	return m_filter.accepts(addr);
+}
+
+// Walk both streamed inputs in address order, like a merge join, and hand
+// each address to processPair(). Only the current CFG of each input is in
+// memory at any time.
+void Strategy::processStream() {
+	CFG* a = this->nextStreamed(m_a);
+	CFG* b = this->nextStreamed(m_b);
+
+	while (a || b) {
+		bool advanceA = a && (!b || a->addr() <= b->addr());
+		bool advanceB = b && (!a || b->addr() <= a->addr());
+
+		CFG* pairA = (advanceA && a->status() == CFG::VALID) ? a : 0;
+		CFG* pairB = (advanceB && b->status() == CFG::VALID) ? b : 0;
+
+		Addr addr = advanceA ? a->addr() : b->addr();
+		if ((pairA || pairB) && this->isAddrInRange(addr))
+			this->processPair(pairA, pairB);
+
+		if (advanceA)
+			a = this->nextStreamed(m_a);
+		if (advanceB)
+			b = this->nextStreamed(m_b);
+	}
+}
+
+// Walk both loaded inputs in address order, the same way as processStream().
+// Both sides are visited once, so pairing is linear in the number of CFGs.
+// With more than one job, the pairs are compared in parallel.
+void Strategy::processLoaded() {
+	std::vector<CFG*> aCFGs = m_a->sortedCfgs();
+	std::vector<CFG*> bCFGs = m_b->sortedCfgs();
+
+	std::vector<Strategy::Pair> pairs;
+	std::vector<CFG*>::const_iterator a = aCFGs.begin();
+	std::vector<CFG*>::const_iterator b = bCFGs.begin();
+	while (a != aCFGs.end() || b != bCFGs.end()) {
+		bool advanceA = a != aCFGs.end() && (b == bCFGs.end() || (*a)->addr() <= (*b)->addr());
+		bool advanceB = b != bCFGs.end() && (a == aCFGs.end() || (*b)->addr() <= (*a)->addr());
+
+		CFG* pairA = (advanceA && (*a)->status() == CFG::VALID) ? *a : 0;
+		CFG* pairB = (advanceB && (*b)->status() == CFG::VALID) ? *b : 0;
+
+		Addr addr = advanceA ? (*a)->addr() : (*b)->addr();
+		if ((pairA || pairB) && this->isAddrInRange(addr))
+			pairs.push_back(Strategy::Pair(pairA, pairB));
+
+		if (advanceA)
+			++a;
+		if (advanceB)
+			++b;
+	}
+
+	if (m_config.jobs > 1 && pairs.size() > 1) {
+		this->processParallel(pairs);
+	} else {
+		for (const Strategy::Pair& pair : pairs)
+			this->processPair(pair.a, pair.b);
+	}
+}
 
-	for (std::list<std::pair<Addr, Addr> >::const_iterator it =  m_config.ranges.cbegin(),
-			ed = m_config.ranges.cend(); it != ed; it++) {
-		if (addr >= it->first && addr <= it->second)
-			return true;
+// The positions of pairs from the most to the least expensive to compare,
+// so that a large CFG is not left to be compared alone at the end.
+std::vector<std::size_t> Strategy::largestFirst(const std::vector<Strategy::Pair>& pairs) const {
+	std::vector<std::size_t> costs(pairs.size(), 0);
+	for (std::size_t i = 0; i < pairs.size(); i++) {
+		for (CFG* cfg : { pairs[i].a, pairs[i].b }) {
+			if (cfg)
+				costs[i] += cfg->graph().countInstructions() + cfg->graph().countEdges();
+		}
 	}
 
-	return false;
+	std::vector<std::size_t> order(pairs.size());
+	for (std::size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&costs](std::size_t x, std::size_t y) {
+		return costs[x] > costs[y];
+	});
+
+	return order;
+}
+
+// Whether each pair leaves something behind besides the totals.
+bool Strategy::writesRows() const {
+	return m_config.detailed || m_fout.is_open() || m_config.follow;
+}
+
+// Read the next CFG of a streamed input and prepare it like the constructor
+// prepares loaded inputs.
+CFG* Strategy::nextStreamed(CFGsContainer* container) {
+	CFG* cfg = container->next();
+	if (!cfg)
+		return 0;
+
+	if (m_config.compress)
+		container->compressAll();
+
+	container->checkAll();
+
+	return cfg;
+}
+
+static volatile sig_atomic_t s_followStop = 0;
+
+static void stopFollow(int) {
+	s_followStop = 1;
+}
+
+// Watch input B while it grows, compare again the CFGs changed by each
+// appended group and print the refreshed totals every interval seconds,
+// until interrupted.
+void Strategy::processFollow() {
+	int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if (fd < 0)
+		throw std::string("Unable to watch file: ") + m_config.input2;
+
+	if (inotify_add_watch(fd, m_config.input2, IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+		close(fd);
+		throw std::string("Unable to watch file: ") + m_config.input2;
+	}
+
+	// Without SA_RESTART, so that poll() returns on the signal.
+	struct sigaction action, oldInt, oldTerm;
+	action.sa_handler = stopFollow;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = 0;
+
+	s_followStop = 0;
+	sigaction(SIGINT, &action, &oldInt);
+	sigaction(SIGTERM, &action, &oldTerm);
+
+	std::chrono::steady_clock::duration interval = std::chrono::seconds(m_config.interval);
+	std::chrono::steady_clock::time_point refresh = std::chrono::steady_clock::now() + interval;
+	std::size_t updated = 0;
+
+	while (!s_followStop) {
+		int timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+			refresh - std::chrono::steady_clock::now()).count();
+
+		struct pollfd pfd = { fd, POLLIN, 0 };
+		if (poll(&pfd, 1, std::max(timeout, 0)) < 0 && errno != EINTR) {
+			close(fd);
+			throw std::string("Unable to watch file: ") + m_config.input2;
+		}
+
+		// Only the events matter, not what they say.
+		char events[4096];
+		while (read(fd, events, sizeof(events)) > 0)
+			;
+
+		// Check the size on timeouts too, events may be lost or coalesced.
+		std::set<Addr> changed;
+		if (m_b->update(changed)) {
+			for (Addr addr : changed)
+				this->compareAgain(addr);
+
+			updated += changed.size();
+		}
+
+		if (std::chrono::steady_clock::now() >= refresh) {
+			if (updated > 0) {
+				std::cout << "Refreshed (" << updated << " CFGs updated):" << std::endl;
+				this->printTotals();
+				std::cout << std::endl;
+
+				updated = 0;
+			}
+
+			refresh = std::chrono::steady_clock::now() + interval;
+		}
+	}
+
+	sigaction(SIGINT, &oldInt, 0);
+	sigaction(SIGTERM, &oldTerm, 0);
+	close(fd);
+}
+
+// Replace the results for addr after the CFG of B at that address changed.
+void Strategy::compareAgain(Addr addr) {
+	this->retractPair(addr);
+
+	if (!this->isAddrInRange(addr))
+		return;
+
+	CFG* a = m_a->cfg(addr);
+	if (a && a->status() != CFG::VALID)
+		a = 0;
+
+	CFG* b = m_b->cfg(addr);
+	if (b && b->check() != CFG::VALID)
+		b = 0;
+
+	if (a || b)
+		this->processPair(a, b);
 }
@@ -0,0 +1,122 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+#include <cstring>
+#include <algorithm>
+
+#include <StringArena.h>
+
+// Strings are copied into blocks of this size, longer ones get their own.
+// The blocks are only freed on exit.
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_TABLE_SIZE 1024
+
+StringArena::Arena StringArena::m_arena;
+
+StringArena::Arena::~Arena() {
+	for (char* memory : blocks)
+		delete[] memory;
+}
+
+// Each string is stored as its length followed by its characters and a
+// terminating zero. The pointer handed out is to the characters.
+typedef uint32_t StoredLength;
+
+static uint64_t textHash(const char* text, std::size_t length) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (std::size_t i = 0; i < length; i++)
+		hash = (hash ^ (unsigned char) text[i]) * 0x100000001b3ULL;
+
+	return hash;
+}
+
+std::size_t StringArena::length(const char* interned) {
+	StoredLength length;
+	std::memcpy(&length, interned - sizeof(length), sizeof(length));
+	return length;
+}
+
+const char* StringArena::intern(const char* text, std::size_t length) {
+	std::lock_guard<std::mutex> guard(m_arena.lock);
+
+	// Keep the table at most half full.
+	if (2 * (m_arena.used + 1) > m_arena.table.size())
+		StringArena::rehash(std::max<std::size_t>(ARENA_TABLE_SIZE, 2 * m_arena.table.size()));
+
+	std::size_t mask = m_arena.table.size() - 1;
+	std::size_t slot = textHash(text, length) & mask;
+	while (const char* interned = m_arena.table[slot]) {
+		if (StringArena::length(interned) == length &&
+				std::memcmp(interned, text, length) == 0)
+			return interned;
+
+		slot = (slot + 1) & mask;
+	}
+
+	std::size_t size = sizeof(StoredLength) + length + 1;
+	char* memory;
+	if (size > ARENA_BLOCK_SIZE) {
+		memory = new char[size];
+		m_arena.blocks.push_back(memory);
+	} else {
+		if (!m_arena.block || m_arena.blockUsed + size > ARENA_BLOCK_SIZE) {
+			m_arena.block = new char[ARENA_BLOCK_SIZE];
+			m_arena.blocks.push_back(m_arena.block);
+			m_arena.blockUsed = 0;
+		}
+
+		memory = m_arena.block + m_arena.blockUsed;
+		m_arena.blockUsed += size;
+	}
+
+	StoredLength stored = length;
+	std::memcpy(memory, &stored, sizeof(stored));
+	std::memcpy(memory + sizeof(stored), text, length);
+	memory[sizeof(stored) + length] = '\0';
+
+	const char* interned = memory + sizeof(stored);
+	m_arena.table[slot] = interned;
+	m_arena.used++;
+
+	return interned;
+}
+
+// Rebuild the table with the given capacity (a power of two).
+void StringArena::rehash(std::size_t capacity) {
+	std::vector<const char*> table(capacity, (const char*) 0);
+
+	std::size_t mask = capacity - 1;
+	for (const char* interned : m_arena.table) {
+		if (!interned)
+			continue;
+
+		std::size_t slot = textHash(interned, StringArena::length(interned)) & mask;
+		while (table[slot])
+			slot = (slot + 1) & mask;
+
+		table[slot] = interned;
+	}
+
+	m_arena.table.swap(table);
+}
@@ -0,0 +1,99 @@
+/*
+
+   Compare two CFGs in CFGgrind format.
+
+   Copyright (C) 2019, Andrei Rimsa (andrei@cefetmg.br)
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+#include <thread>
+#include <cassert>
+
+#include <WorkPool.h>
+
+WorkPool::WorkPool(int workers) : m_queues(workers) {
+	assert(workers > 0);
+}
+
+WorkPool::~WorkPool() {
+}
+
+void WorkPool::run(const std::vector<std::size_t>& tasks, const WorkPool::Task& task) {
+	// Deal the tasks round robin, so every queue starts with the first ones.
+	int workers = m_queues.size();
+	for (std::size_t i = 0; i < tasks.size(); i++)
+		m_queues[i % workers].tasks.push_back(tasks[i]);
+
+	m_error.clear();
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < workers; i++)
+		threads.push_back(std::thread(&WorkPool::work, this, i, std::cref(task)));
+
+	this->work(0, task);
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	if (!m_error.empty())
+		throw m_error;
+}
+
+// A failed task stops its worker, the others drain what is left.
+void WorkPool::work(int worker, const WorkPool::Task& task) {
+	try {
+		std::size_t next;
+		while (this->take(worker, next) || this->steal(worker, next))
+			task(worker, next);
+	} catch (const std::string& error) {
+		std::lock_guard<std::mutex> guard(m_errorLock);
+		if (m_error.empty())
+			m_error = error;
+	}
+}
+
+bool WorkPool::take(int worker, std::size_t& task) {
+	Queue& queue = m_queues[worker];
+	std::lock_guard<std::mutex> guard(queue.lock);
+	if (queue.tasks.empty())
+		return false;
+
+	task = queue.tasks.front();
+	queue.tasks.pop_front();
+	return true;
+}
+
+// Tasks are only added before the workers start, so a worker that finds
+// every queue empty is done.
+bool WorkPool::steal(int worker, std::size_t& task) {
+	int workers = m_queues.size();
+	for (int i = 1; i < workers; i++) {
+		Queue& queue = m_queues[(worker + i) % workers];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		if (queue.tasks.empty())
+			continue;
+
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	return false;
+}
@@ -71,11 +71,39 @@ void usage(char* progname) {
 	std::cout << "   -i   File        Instructions map (address:size:assembly per entry) file" << std::endl;
 	std::cout << "   -o   File        Output statistics report file" << std::endl;
 	std::cout << "   -d   Directory   Dump DOT cfgs in directory" << std::endl;
+	std::cout << "   -j   Jobs        Number of threads used to parse each CFG file," << std::endl;
+	std::cout << "                        the instructions map and to compare the CFGs" << std::endl;
+	std::cout << "   -C               Cache parsed CFG files as binary snapshots" << std::endl;
+	std::cout << "                        (file.cfgs is cached in file.cfgb)" << std::endl;
+	std::cout << "   -I               Index CFG files (file.cfgs is indexed in file.cfgi)" << std::endl;
+	std::cout << "                        to load only the CFGs selected by -r/-a/-A" << std::endl;
+	std::cout << "   -S               Stream CFG files grouped and sorted by CFG address," << std::endl;
+	std::cout << "                        comparing each CFG as soon as it is read" << std::endl;
+	std::cout << "   -v               Print load statistics to stderr" << std::endl;
+	std::cout << "   --follow         Keep reading CFG file B while it is written, comparing" << std::endl;
+	std::cout << "                        the CFGs of each appended group (until Ctrl-C)" << std::endl;
+	std::cout << "   --interval Secs  Seconds between refreshed totals with --follow [default: 10]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "CFG files and instructions maps may be compressed with gzip, zstd or xz." << std::endl;
+	std::cout << "A CFG file may also be - (standard input) or a pipe, which is read once" << std::endl;
+	std::cout << "and must not be compressed." << std::endl;
 	std::cout << std::endl;
 
 	exit(1);
 }
 
+// Long options without a short form.
+enum {
+	OPT_FOLLOW = 256,
+	OPT_INTERVAL
+};
+
+static const struct option longOptions[] = {
+	{ "follow",   no_argument,       0, OPT_FOLLOW },
+	{ "interval", required_argument, 0, OPT_INTERVAL },
+	{ 0,          0,                 0, 0 }
+};
+
 StrategyConfig readoptions(int argc, char* argv[]) {
 	int opt;
 	char* idx;
@@ -83,7 +111,7 @@ StrategyConfig readoptions(int argc, char* argv[]) {
 	std::ifstream input;
 	StrategyConfig config;
 
-	while ((opt = getopt(argc, argv, ":cps:br:a:A:i:o:d:")) != -1) {
+	while ((opt = getopt_long(argc, argv, ":cps:br:a:A:i:o:d:j:CISv", longOptions, 0)) != -1) {
 		switch (opt) {
 			case 'c':
 				config.compress = true;
@@ -163,6 +191,31 @@ StrategyConfig readoptions(int argc, char* argv[]) {
 			case 'd':
 				config.dump = optarg;
 				break;
+			case 'j':
+				config.jobs = std::stoi(optarg);
+				if (config.jobs < 1)
+					throw std::string("invalid number of jobs: ") + optarg;
+				break;
+			case 'C':
+				config.cache = true;
+				break;
+			case 'I':
+				config.index = true;
+				break;
+			case 'S':
+				config.stream = true;
+				break;
+			case 'v':
+				config.verbose = true;
+				break;
+			case OPT_FOLLOW:
+				config.follow = true;
+				break;
+			case OPT_INTERVAL:
+				config.interval = std::stoi(optarg);
+				if (config.interval < 1)
+					throw std::string("invalid interval: ") + optarg;
+				break;
 			default:
 				throw std::string("Invalid option: ") + (char) optopt;
 		}
@@ -177,9 +230,19 @@ StrategyConfig readoptions(int argc, char* argv[]) {
 	if (optind < argc)
 		throw std::string("Unknown extra option: ") + argv[optind];
 
+	if (strcmp(config.input1, "-") == 0 && strcmp(config.input2, "-") == 0)
+		throw std::string("Only one CFG file can be read from standard input");
+
 	if (!config.both && config.specific)
 		throw std::string("-b must be used with specific strategy");
 
+	if (config.stream && (config.cache || config.index || config.dump))
+		throw std::string("-S cannot be used with -C, -I or -d");
+
+	if (config.follow && (config.compress || config.stream || config.cache ||
+			config.index || config.dump))
+		throw std::string("--follow cannot be used with -c, -S, -C, -I or -d");
+
 	return config;
 }
 
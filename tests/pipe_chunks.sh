@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# Feed CFG file A through a pipe in chunks that end right after the first
+# token of a record, so that peeking at the record's CFG address makes the
+# window refill. The totals must be the same as reading A from a file.
+#
+# usage: pipe_chunks.sh cmpcfgs
+
+BIN=$1
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+record() {
+	printf '[cfg\n0x%x:4 "f%x" true\n]\n' $1 $1
+	printf '[node\n0x%x 0x%x 4 [1 3] [] [] false [exit]\n]\n' $1 $1
+}
+
+feed() {
+	for addr in 4096 8192 12288 16384; do
+		record $addr | while IFS= read -r line; do
+			printf '%s\n' "$line"
+			sleep 0.05
+		done
+	done
+}
+
+feed > "$TMP/a.cfgs"
+record 8192 > "$TMP/b.cfgs"
+record 16384 >> "$TMP/b.cfgs"
+
+status=0
+for flags in "" "-a 0x2000 -a 0x3000" "-S" "-S -r 0x2000:0x4000"; do
+	"$BIN" $flags "$TMP/a.cfgs" "$TMP/b.cfgs" > "$TMP/file.out" 2>&1
+	feed | "$BIN" $flags - "$TMP/b.cfgs" > "$TMP/pipe.out" 2>&1
+
+	if ! cmp -s "$TMP/file.out" "$TMP/pipe.out"; then
+		echo "pipe input differs with flags: $flags"
+		diff "$TMP/file.out" "$TMP/pipe.out"
+		status=1
+	fi
+done
+
+exit $status